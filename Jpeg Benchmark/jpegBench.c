@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jpegDecoder.h"
+
+struct benchTotals {
+	int images;
+	int decodes;
+	double bytes;
+	double pixels;
+	struct jpegStats stats;
+};
+
+const char* defaultImages[] = {
+	"arcane.jpg", "arcane2.jpg", "gwen.jpg", "sinners.jpg", "avengers.jpg", "vi.jpg", "test.jpg", "test2.jpg",
+	"arcaneProg.jpg", "gwenProg.jpg", "sinnersProg.jpg"
+};
+
+unsigned char* readFile(const char* fileName, size_t* size) {
+	FILE* file = NULL;
+#ifdef _MSC_VER
+	if (fopen_s(&file, fileName, "rb") != 0) {
+		return NULL;
+	}
+#else
+	file = fopen(fileName, "rb");
+	if (!file) {
+		return NULL;
+	}
+#endif
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	unsigned char* data = length > 0 ? malloc(length) : NULL;
+	if (!data || fread(data, 1, length, file) != (size_t)length) {
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+	*size = (size_t)length;
+	return data;
+}
+
+void addStats(struct jpegStats* total, const struct jpegStats* stats) {
+	total->totalSeconds += stats->totalSeconds;
+	total->cpuSeconds += stats->cpuSeconds;
+	total->markerSeconds += stats->markerSeconds;
+	total->entropySeconds += stats->entropySeconds;
+	total->idctSeconds += stats->idctSeconds;
+	total->colorSeconds += stats->colorSeconds;
+}
+
+void printTotals(const char* label, const struct benchTotals* totals) {
+	const struct jpegStats* stats = &totals->stats;
+	double seconds = stats->totalSeconds > 0 ? stats->totalSeconds : 1e-9;
+	double cpuSeconds = stats->cpuSeconds > 0 ? stats->cpuSeconds : 1e-9;
+	double percent = 100.0 / cpuSeconds;
+	printf("%-16s %8.2f ms %8.2f cpu ms %8.1f MB/s %8.1f MP/s | marker %5.1f%% huffman %5.1f%% idct %5.1f%% color %5.1f%% of cpu\n",
+		label, seconds * 1000.0 / totals->decodes, cpuSeconds * 1000.0 / totals->decodes, totals->bytes / seconds / 1e6, totals->pixels / seconds / 1e6,
+		stats->markerSeconds * percent, stats->entropySeconds * percent, stats->idctSeconds * percent, stats->colorSeconds * percent);
+}
+
+int benchBatch(struct jpegOptions* options, int jobs, int iterations, char** paths, int numPaths) {
+	const char** fileNames = malloc(sizeof(const char*) * numPaths * iterations);
+	if (!fileNames) {
+		printf("allocation failed\n");
+		return 1;
+	}
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < numPaths; i++) {
+			fileNames[n * numPaths + i] = paths[i];
+		}
+	}
+	struct jpegBatchStats stats;
+	options->threads = jobs;
+	enum jpegStatus status = jpegDecodeFiles(options, fileNames, numPaths * iterations, NULL, NULL, &stats);
+	free(fileNames);
+	if (status != JPEG_OK) {
+		printf("batch decode failed: %s\n", jpegStatusString(status));
+		return 1;
+	}
+	double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+	printf("%d jobs, %d images, %d failed: %8.2f s %8.1f images/s %8.1f MB/s %8.1f MP/s\n", jobs, stats.images, stats.failures,
+		stats.seconds, stats.images / seconds, stats.bytes / seconds / 1e6, stats.pixels / seconds / 1e6);
+	return stats.failures ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+	struct jpegOptions options;
+	int iterations = 10;
+	int jobs = 0;
+	const char* directory = "../Jpeg Decoder";
+	jpegDefaultOptions(&options);
+	int arg = 1;
+	while (arg + 1 < argc && argv[arg][0] == '-') {
+		if (strcmp(argv[arg], "-n") == 0) {
+			iterations = atoi(argv[arg + 1]);
+			if (iterations < 1) {
+				printf("iteration count must be positive\n");
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-dir") == 0) {
+			directory = argv[arg + 1];
+		} else if (strcmp(argv[arg], "-idct") == 0) {
+			if (strcmp(argv[arg + 1], "float") == 0) {
+				options.idctMethod = IDCT_FLOAT;
+			} else if (strcmp(argv[arg + 1], "reference") == 0) {
+				options.idctMethod = IDCT_REFERENCE;
+			} else if (strcmp(argv[arg + 1], "int") != 0) {
+				printf("unknown idct method %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-upsample") == 0) {
+			if (strcmp(argv[arg + 1], "replicate") == 0) {
+				options.upsampleMethod = UPSAMPLE_REPLICATE;
+			} else if (strcmp(argv[arg + 1], "fancy") != 0) {
+				printf("unknown upsampling method %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-format") == 0) {
+			if (strcmp(argv[arg + 1], "rgba") == 0) {
+				options.pixelFormat = PIXEL_RGBA32;
+			} else if (strcmp(argv[arg + 1], "bgra") == 0) {
+				options.pixelFormat = PIXEL_BGRA32;
+			} else if (strcmp(argv[arg + 1], "gray") == 0) {
+				options.pixelFormat = PIXEL_GRAY8;
+			} else if (strcmp(argv[arg + 1], "yuv") == 0) {
+				options.pixelFormat = PIXEL_YUV_PLANAR;
+			} else if (strcmp(argv[arg + 1], "raw") == 0) {
+				options.pixelFormat = PIXEL_YUV_RAW;
+			} else if (strcmp(argv[arg + 1], "rgb") != 0) {
+				printf("unknown pixel format %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-simd") == 0) {
+			if (strcmp(argv[arg + 1], "none") == 0) {
+				options.simdLevel = SIMD_NONE;
+			} else if (strcmp(argv[arg + 1], "sse2") == 0) {
+				options.simdLevel = SIMD_SSE2;
+			} else if (strcmp(argv[arg + 1], "avx2") != 0) {
+				printf("unknown simd level %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-progressive") == 0) {
+			if (strcmp(argv[arg + 1], "scan") == 0) {
+				options.progressiveMode = PROGRESSIVE_EVERY_SCAN;
+			} else if (strcmp(argv[arg + 1], "incremental") == 0) {
+				options.progressiveMode = PROGRESSIVE_INCREMENTAL;
+			} else if (strcmp(argv[arg + 1], "final") != 0) {
+				printf("unknown progressive mode %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-threads") == 0) {
+			options.threads = atoi(argv[arg + 1]);
+			if (options.threads < 1) {
+				printf("thread count must be positive\n");
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-jobs") == 0) {
+			jobs = atoi(argv[arg + 1]);
+			if (jobs < 1) {
+				printf("job count must be positive\n");
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-scale") == 0) {
+			options.scaleDenominator = atoi(argv[arg + 1]);
+			if (options.scaleDenominator != 1 && options.scaleDenominator != 2 && options.scaleDenominator != 4 && options.scaleDenominator != 8) {
+				printf("scale must be 1, 2, 4 or 8\n");
+				return 1;
+			}
+		} else {
+			printf("unknown option %s\n", argv[arg]);
+			return 1;
+		}
+		arg += 2;
+	}
+	int pixelSize = options.pixelFormat == PIXEL_RGB24 ? 3 : options.pixelFormat == PIXEL_RGBA32 || options.pixelFormat == PIXEL_BGRA32 ? 4 : 1;
+	int planes = options.pixelFormat >= PIXEL_YUV_PLANAR ? 3 : 1;
+	int numImages = arg < argc ? argc - arg : (int)(sizeof(defaultImages) / sizeof(defaultImages[0]));
+	if (jobs > 0) {
+		char** paths = malloc(sizeof(char*) * numImages);
+		char* storage = malloc((size_t)numImages * 1024);
+		int result = 1;
+		if (paths && storage) {
+			for (int i = 0; i < numImages; i++) {
+				paths[i] = storage + (size_t)i * 1024;
+				if (arg < argc) {
+					snprintf(paths[i], 1024, "%s", argv[arg + i]);
+				} else {
+					snprintf(paths[i], 1024, "%s/%s", directory, defaultImages[i]);
+				}
+			}
+			result = benchBatch(&options, jobs, iterations, paths, numImages);
+		} else {
+			printf("allocation failed\n");
+		}
+		free(storage);
+		free(paths);
+		return result;
+	}
+	struct jpegDecoder* decoder = jpegCreate(&options);
+	if (!decoder) {
+		printf("allocation failed\n");
+		return 1;
+	}
+	struct benchTotals groups[2];
+	memset(groups, 0, sizeof(groups));
+	unsigned char* pixels = NULL;
+	size_t capacity = 0;
+	int failures = 0;
+	printf("%d iterations per image\n", iterations);
+	for (int i = 0; i < numImages; i++) {
+		char path[1024];
+		if (arg < argc) {
+			snprintf(path, sizeof(path), "%s", argv[arg + i]);
+		} else {
+			snprintf(path, sizeof(path), "%s/%s", directory, defaultImages[i]);
+		}
+		size_t size = 0;
+		unsigned char* data = readFile(path, &size);
+		if (!data) {
+			printf("%s: could not read file\n", path);
+			failures++;
+			continue;
+		}
+		struct jpegInfo info;
+		struct benchTotals image;
+		memset(&image, 0, sizeof(image));
+		enum jpegStatus status = JPEG_OK;
+		for (int n = -1; n < iterations && status == JPEG_OK; n++) {
+			status = jpegOpenMemory(decoder, data, size);
+			if (status == JPEG_OK) {
+				status = jpegReadHeader(decoder, &info);
+			}
+			if (status != JPEG_OK) {
+				break;
+			}
+			size_t stride = (size_t)info.width * pixelSize;
+			size_t needed = stride * info.height * planes;
+			if (needed > capacity) {
+				unsigned char* grown = realloc(pixels, needed);
+				if (!grown) {
+					status = JPEG_ERROR_MEMORY;
+					break;
+				}
+				pixels = grown;
+				capacity = needed;
+			}
+			status = jpegDecode(decoder, pixels, stride);
+			if (status == JPEG_OK && n >= 0) {
+				struct jpegStats stats;
+				jpegGetStats(decoder, &stats);
+				addStats(&image.stats, &stats);
+				image.decodes++;
+				image.bytes += (double)size;
+				image.pixels += (double)info.width * info.height;
+			}
+		}
+		free(data);
+		if (status != JPEG_OK) {
+			printf("%s: %s\n", path, jpegStatusString(status));
+			failures++;
+			continue;
+		}
+		const char* name = strrchr(path, '/');
+		name = name ? name + 1 : path;
+		printf("%-16s %dx%d %s\n", name, info.width, info.height, info.progressive ? "progressive" : "baseline");
+		printTotals("", &image);
+		struct benchTotals* group = &groups[info.progressive ? 1 : 0];
+		group->images++;
+		group->decodes += image.decodes;
+		group->bytes += image.bytes;
+		group->pixels += image.pixels;
+		addStats(&group->stats, &image.stats);
+	}
+	printf("\n");
+	if (groups[0].images) {
+		printTotals("baseline", &groups[0]);
+	}
+	if (groups[1].images) {
+		printTotals("progressive", &groups[1]);
+	}
+	free(pixels);
+	jpegDestroy(decoder);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+#include "jpegDecoder.h"
+
+enum outputFormat {
+	FORMAT_PPM,
+	FORMAT_PGM,
+	FORMAT_RGB,
+	FORMAT_GRAY,
+	FORMAT_YUV
+};
+
+FILE* openOutput(const char* fileName) {
+	if (strcmp(fileName, "-") == 0) {
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		return stdout;
+	}
+#ifdef _MSC_VER
+	FILE* file = NULL;
+	if (fopen_s(&file, fileName, "wb") != 0) {
+		return NULL;
+	}
+	return file;
+#else
+	return fopen(fileName, "wb");
+#endif
+}
+
+const char* formatExtension(enum outputFormat format) {
+	switch (format) {
+	case FORMAT_PPM:
+		return ".ppm";
+	case FORMAT_PGM:
+		return ".pgm";
+	case FORMAT_RGB:
+		return ".rgb";
+	case FORMAT_GRAY:
+		return ".gray";
+	case FORMAT_YUV:
+		return ".yuv";
+	}
+	return "";
+}
+
+char* deriveOutputName(const char* inputName, enum outputFormat format) {
+	const char* extension = formatExtension(format);
+	const char* dot = strrchr(inputName, '.');
+	const char* slash = strrchr(inputName, '/');
+	const char* backslash = strrchr(inputName, '\\');
+	if (backslash > slash) {
+		slash = backslash;
+	}
+	size_t baseLength = (dot && dot > slash) ? (size_t)(dot - inputName) : strlen(inputName);
+	char* name = malloc(baseLength + strlen(extension) + 1);
+	if (!name) {
+		return NULL;
+	}
+	memcpy(name, inputName, baseLength);
+	memcpy(name + baseLength, extension, strlen(extension) + 1);
+	return name;
+}
+
+void writeHeader(FILE* file, enum outputFormat format, int width, int height) {
+	if (format == FORMAT_PPM) {
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+	} else if (format == FORMAT_PGM) {
+		fprintf(file, "P5\n%d %d\n255\n", width, height);
+	}
+}
+
+int writeRows(FILE* file, enum outputFormat format, const unsigned char* pixels, int width, int rows) {
+	int channels = (format == FORMAT_PPM || format == FORMAT_RGB) ? 3 : 1;
+	size_t size = (size_t)width * rows * channels;
+	return fwrite(pixels, 1, size, file) == size ? 0 : 1;
+}
+
+int writePlanes(FILE* file, struct jpegDecoder* decoder, const unsigned char* pixels, size_t stride, int components) {
+	for (int c = 0; c < components; c++) {
+		int width, height;
+		if (jpegGetPlaneSize(decoder, c, &width, &height) != JPEG_OK) {
+			return 1;
+		}
+		for (int y = 0; y < height; y++, pixels += stride) {
+			if (fwrite(pixels, 1, width, file) != (size_t)width) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+struct batchOutput {
+	enum outputFormat format;
+	bool quiet;
+	char** inputNames;
+	int* writeFailures;
+};
+
+void writeImage(void* user, int worker, int index, struct jpegDecoder* decoder, enum jpegStatus status, const unsigned char* pixels, size_t stride) {
+	struct batchOutput* output = (struct batchOutput*)user;
+	const char* inputName = output->inputNames[index];
+	struct jpegInfo info;
+	if (status != JPEG_OK || jpegReadHeader(decoder, &info) != JPEG_OK) {
+		fprintf(stderr, "%s: %s\n", inputName, jpegStatusString(status));
+		return;
+	}
+	char* fileName = deriveOutputName(inputName, output->format);
+	FILE* file = fileName ? openOutput(fileName) : NULL;
+	if (!file) {
+		fprintf(stderr, "%s: could not open output\n", inputName);
+		output->writeFailures[worker]++;
+		free(fileName);
+		return;
+	}
+	writeHeader(file, output->format, info.width, info.height);
+	int failed = output->format == FORMAT_YUV ? writePlanes(file, decoder, pixels, stride, info.components) : writeRows(file, output->format, pixels, info.width, info.height);
+	if (fclose(file) != 0 || failed) {
+		fprintf(stderr, "%s: write failed\n", fileName);
+		output->writeFailures[worker]++;
+	} else if (!output->quiet) {
+		printf("%s -> %s (%dx%d)\n", inputName, fileName, info.width, info.height);
+	}
+	free(fileName);
+}
+
+int decodeBatch(struct jpegOptions* options, int jobs, enum outputFormat format, bool quiet, char** inputNames, int count) {
+	struct batchOutput output;
+	output.format = format;
+	output.quiet = quiet;
+	output.inputNames = inputNames;
+	output.writeFailures = calloc(jobs, sizeof(int));
+	if (!output.writeFailures) {
+		printf("allocation failed\n");
+		return 1;
+	}
+	struct jpegBatchStats stats;
+	options->threads = jobs;
+	enum jpegStatus status = jpegDecodeFiles(options, (const char* const*)inputNames, count, writeImage, &output, &stats);
+	int failures = stats.failures;
+	for (int i = 0; i < jobs; i++) {
+		failures += output.writeFailures[i];
+	}
+	free(output.writeFailures);
+	if (status != JPEG_OK) {
+		printf("batch decode failed: %s\n", jpegStatusString(status));
+		return 1;
+	}
+	if (!quiet) {
+		double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+		printf("%d images in %.2f s: %.1f images/s, %.1f MP/s, %.1f MB/s\n", stats.images, stats.seconds, stats.images / seconds, stats.pixels / seconds / 1e6, stats.bytes / seconds / 1e6);
+	}
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+	struct jpegOptions options;
+	enum outputFormat format = FORMAT_PPM;
+	const char* outputName = NULL;
+	bool quiet = false;
+	int crop[4] = { 0, 0, 0, 0 };
+	int jobs = 0;
+	jpegDefaultOptions(&options);
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0') {
+		if (strcmp(argv[arg], "-q") == 0) {
+			quiet = true;
+			arg++;
+			continue;
+		}
+		if (arg + 1 >= argc) {
+			printf("missing value for %s\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(argv[arg], "-o") == 0) {
+			outputName = argv[arg + 1];
+		} else if (strcmp(argv[arg], "-format") == 0) {
+			if (strcmp(argv[arg + 1], "ppm") == 0) {
+				format = FORMAT_PPM;
+			} else if (strcmp(argv[arg + 1], "pgm") == 0) {
+				format = FORMAT_PGM;
+			} else if (strcmp(argv[arg + 1], "rgb") == 0) {
+				format = FORMAT_RGB;
+			} else if (strcmp(argv[arg + 1], "gray") == 0) {
+				format = FORMAT_GRAY;
+			} else if (strcmp(argv[arg + 1], "yuv") == 0) {
+				format = FORMAT_YUV;
+			} else {
+				printf("unknown format %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-idct") == 0) {
+			if (strcmp(argv[arg + 1], "float") == 0) {
+				options.idctMethod = IDCT_FLOAT;
+			} else if (strcmp(argv[arg + 1], "reference") == 0) {
+				options.idctMethod = IDCT_REFERENCE;
+			} else if (strcmp(argv[arg + 1], "int") != 0) {
+				printf("unknown idct method %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-upsample") == 0) {
+			if (strcmp(argv[arg + 1], "replicate") == 0) {
+				options.upsampleMethod = UPSAMPLE_REPLICATE;
+			} else if (strcmp(argv[arg + 1], "fancy") != 0) {
+				printf("unknown upsampling method %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-simd") == 0) {
+			if (strcmp(argv[arg + 1], "none") == 0) {
+				options.simdLevel = SIMD_NONE;
+			} else if (strcmp(argv[arg + 1], "sse2") == 0) {
+				options.simdLevel = SIMD_SSE2;
+			} else if (strcmp(argv[arg + 1], "avx2") != 0) {
+				printf("unknown simd level %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-threads") == 0) {
+			options.threads = atoi(argv[arg + 1]);
+			if (options.threads < 1) {
+				printf("thread count must be positive\n");
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-jobs") == 0) {
+			jobs = atoi(argv[arg + 1]);
+			if (jobs < 1) {
+				printf("job count must be positive\n");
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-scale") == 0) {
+			options.scaleDenominator = atoi(argv[arg + 1]);
+			if (options.scaleDenominator != 1 && options.scaleDenominator != 2 && options.scaleDenominator != 4 && options.scaleDenominator != 8) {
+				printf("scale must be 1, 2, 4 or 8\n");
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-crop") == 0) {
+			if (sscanf(argv[arg + 1], "%d,%d,%d,%d", &crop[0], &crop[1], &crop[2], &crop[3]) != 4 || crop[0] < 0 || crop[1] < 0 || crop[2] < 1 || crop[3] < 1) {
+				printf("crop must be x,y,width,height\n");
+				return 1;
+			}
+		} else {
+			printf("unknown option %s\n", argv[arg]);
+			return 1;
+		}
+		arg += 2;
+	}
+	if (arg >= argc) {
+		printf("usage: %s [-o file|-] [-format ppm|pgm|rgb|gray|yuv] [-idct int|float|reference] [-upsample fancy|replicate] [-simd none|sse2|avx2] [-threads n] [-jobs n] [-scale 1|2|4|8] [-crop x,y,w,h] [-q] <file.jpg>...\n", argv[0]);
+		return 1;
+	}
+	if (outputName && strcmp(outputName, "-") != 0 && argc - arg > 1) {
+		printf("-o with a file name needs a single input; use -o - or omit it\n");
+		return 1;
+	}
+	if (outputName && strcmp(outputName, "-") == 0) {
+		quiet = true;
+	}
+	if (jobs > 0 && (outputName || crop[2] > 0)) {
+		printf("-jobs writes one derived output per input and cannot be combined with -o or -crop\n");
+		return 1;
+	}
+	int channels = (format == FORMAT_PPM || format == FORMAT_RGB) ? 3 : 1;
+	options.pixelFormat = channels == 3 ? PIXEL_RGB24 : format == FORMAT_YUV ? PIXEL_YUV_RAW : PIXEL_GRAY8;
+	if (jobs > 0) {
+		return decodeBatch(&options, jobs, format, quiet, argv + arg, argc - arg);
+	}
+	struct jpegDecoder* decoder = jpegCreate(&options);
+	if (!decoder) {
+		printf("allocation failed\n");
+		return 1;
+	}
+	const int stripRows = 16;
+	unsigned char* pixels = NULL;
+	size_t capacity = 0;
+	int failures = 0;
+	for (; arg < argc; arg++) {
+		const char* inputName = argv[arg];
+		struct jpegInfo info;
+		enum jpegStatus status = jpegOpenFile(decoder, inputName);
+		if (status == JPEG_OK) {
+			status = jpegReadHeader(decoder, &info);
+		}
+		if (status == JPEG_OK && crop[2] > 0) {
+			int width = crop[2] < info.width - crop[0] ? crop[2] : info.width - crop[0];
+			int height = crop[3] < info.height - crop[1] ? crop[3] : info.height - crop[1];
+			status = jpegSetCrop(decoder, crop[0], crop[1], width, height);
+			info.width = width;
+			info.height = height;
+		}
+		size_t stride = status == JPEG_OK ? (size_t)info.width * channels : 0;
+		size_t rows = format == FORMAT_YUV ? 0 : stripRows;
+		for (int c = 0; format == FORMAT_YUV && status == JPEG_OK && c < info.components; c++) {
+			int planeWidth, planeHeight;
+			status = jpegGetPlaneSize(decoder, c, &planeWidth, &planeHeight);
+			rows += planeHeight;
+		}
+		if (status == JPEG_OK && stride * rows > capacity) {
+			unsigned char* grown = realloc(pixels, stride * rows);
+			if (!grown) {
+				status = JPEG_ERROR_MEMORY;
+			} else {
+				pixels = grown;
+				capacity = stride * rows;
+			}
+		}
+		if (status != JPEG_OK) {
+			fprintf(stderr, "%s: %s\n", inputName, jpegStatusString(status));
+			failures++;
+			continue;
+		}
+		char* derivedName = NULL;
+		const char* fileName = outputName;
+		if (!fileName) {
+			derivedName = deriveOutputName(inputName, format);
+			fileName = derivedName;
+		}
+		FILE* file = fileName ? openOutput(fileName) : NULL;
+		if (!file) {
+			fprintf(stderr, "%s: could not open output\n", inputName);
+			failures++;
+			free(derivedName);
+			continue;
+		}
+		writeHeader(file, format, info.width, info.height);
+		int rowsRead = 0;
+		bool written = true;
+		if (format == FORMAT_YUV) {
+			status = jpegDecode(decoder, pixels, stride);
+			if (status == JPEG_OK) {
+				written = writePlanes(file, decoder, pixels, stride, info.components) == 0;
+			}
+		} else {
+			do {
+				status = jpegReadScanlines(decoder, pixels, stride, stripRows, &rowsRead);
+				if (status == JPEG_OK && rowsRead > 0 && written) {
+					written = writeRows(file, format, pixels, info.width, rowsRead) == 0;
+				}
+			} while (status == JPEG_OK && rowsRead > 0);
+		}
+		if (status != JPEG_OK) {
+			fprintf(stderr, "%s: %s\n", inputName, jpegStatusString(status));
+			failures++;
+		} else if (!written) {
+			fprintf(stderr, "%s: write failed\n", fileName);
+			failures++;
+		} else if (!quiet) {
+			printf("%s -> %s (%dx%d)\n", inputName, fileName, info.width, info.height);
+		}
+		if (file == stdout) {
+			fflush(file);
+		} else {
+			fclose(file);
+		}
+		free(derivedName);
+	}
+	free(pixels);
+	jpegDestroy(decoder);
+	return failures ? 1 : 0;
+}
@@ -1,867 +1,1873 @@
-#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
 #include <math.h>
-#include <SDL3/SDL.h>
+#include <time.h>
+#include <threads.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "jpegDecoder.h"
+#include "jpegKernels.h"
+#include "jpegThreads.h"
 
-struct huffmanNode {
-	unsigned char data, type, id;
-	struct huffmanNode* left, * right;
+#define HUFFMAN_LOOKAHEAD 9
+#define PIPELINE_STAGES 3
+#define PIPELINE_ROWS 4
+
+struct huffmanTable {
+	unsigned char type, id;
+	unsigned char values[256];
+	int maxcode[18];
+	int valptr[17];
+	unsigned short lookahead[1 << HUFFMAN_LOOKAHEAD];
+};
+
+struct bitReader {
+	const unsigned char* data;
+	size_t size;
+	size_t pos;
+	uint64_t acc;
+	int bits;
+	unsigned char marker;
+	bool markerFound;
+	size_t markerPos;
+};
+
+struct mappedFile {
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
 };
 
 struct quantTable {
-	unsigned char data[8][8];
-	unsigned char info;
+	int natural[64];
+	float scaled[64];
 };
 
 struct component {
 	unsigned char id;
 	unsigned char samplingFactors;
 	unsigned char quantTable;
-	int oldDC;
 	unsigned char dcTable;
 	unsigned char acTable;
+	int h, v;
+	int ratioH, ratioV;
+	int blocksPerLine, blocksPerColumn;
+	int scanBlocksPerLine, scanBlocksPerColumn;
+	int sampleWidth, sampleHeight;
+	bool fancyH, fancyV;
+	int firstBlock;
+	int storedBlockRows;
+	short* coefficients;
 };
 
 struct componentBlock {
-	float pixels[8][8];
-	unsigned char componentId;
+	short pixels[8][8];
 };
 
-struct pixelBlock {
-	unsigned char pixelsR[8][8];
-	unsigned char pixelsG[8][8];
-	unsigned char pixelsB[8][8];
+struct scanContext {
+	struct jpegDecoder* decoder;
+	int componentsInScan;
+	int scanComponents[4];
+	int ss, se, ah, al;
+	int totalMcus;
+	int mcusPerLine;
+	int cropLeft, cropRight, cropTop, cropBottom;
+	const size_t* segmentStarts;
+	double* segmentSeconds;
 };
 
-void insertIntoTree(struct huffmanNode* root, unsigned int code, int length, unsigned char value) {
-	struct huffmanNode* node = root;
-	for (int i = length - 1; i >= 0; i--) {
-		int bit = (code >> i) & 1;
-		if (bit == 0) {
-			if (!node->left) {
-				node->left = malloc(sizeof(struct huffmanNode));
-				node->left->data = 0xFF;
-				node->left->left = NULL;
-				node->left->right = NULL;
-				node->left->id = node->id;
-				node->left->type = node->type;
-			}
-			node = node->left;
-		} else {
-			if (!node->right) {
-				node->right = malloc(sizeof(struct huffmanNode));
-				node->right->data = 0xFF;
-				node->right->left = NULL;
-				node->right->right = NULL;
-				node->right->id = node->id;
-				node->right->type = node->type;
-			}
-			node = node->right;
-		}
-	}
-	node->data = value;
+struct scanState {
+	struct bitReader reader;
+	int eobrun;
+	int dcPredictors[3];
+	bool skipping;
+};
+
+struct pipeline {
+	mtx_t lock;
+	cnd_t progress;
+	int stages;
+	int rows[PIPELINE_STAGES];
+	bool done[PIPELINE_STAGES];
+	struct jpegStats stats[PIPELINE_STAGES];
+	double stallSeconds;
+};
+
+struct jpegDecoder {
+	struct jpegOptions options;
+	struct kernels kernels;
+	struct mappedFile file;
+	bool fileMapped;
+	const unsigned char* data;
+	size_t size;
+	size_t pos;
+	bool frameRead;
+	struct jpegInfo info;
+	struct huffmanTable* dcTables[4];
+	struct huffmanTable* acTables[4];
+	struct quantTable* qtables[4];
+	struct component components[3];
+	int numComponents;
+	int mcusPerLine, mcusPerColumn;
+	int blockSize;
+	int cropX, cropY, cropWidth, cropHeight;
+	int marginX, marginY;
+	int contextRows;
+	int totalBlocks;
+	int restartInterval;
+	struct threadPool* pool;
+	struct componentBlock* out;
+	short* rowBuffer;
+	short* sampleRows;
+	bool streaming;
+	int pipelineStages;
+	struct pipeline* pipeline;
+	unsigned char* output;
+	size_t stride;
+	int outputOrigin;
+	struct scanContext scan;
+	struct scanState scanState;
+	bool scanActive;
+	int nextMcu;
+	int scans;
+	bool segmentsDone;
+	bool pulling;
+	unsigned char* band;
+	int bandNext;
+	int bandEnd;
+	unsigned char* dirtyBlocks;
+	unsigned char* blockExtents;
+	int* dirtyColumns;
+	struct jpegStats stats;
+	double parallelSeconds;
+	double parallelStageSeconds;
+};
+
+struct batchWorker {
+	struct jpegDecoder* decoder;
+	unsigned char* pixels;
+	size_t capacity;
+	struct jpegBatchStats stats;
+};
+
+struct batchContext {
+	const char* const* fileNames;
+	int count;
+	int nextFile;
+	mtx_t lock;
+	struct batchWorker* workers;
+	void (*imageDecoded)(void* user, int worker, int index, struct jpegDecoder* decoder, enum jpegStatus status, const unsigned char* pixels, size_t stride);
+	void* user;
+};
+
+static double currentTime(void) {
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
 }
 
-struct huffmanNode* createTreeFromLengths(char* lengths, char* elements, unsigned char htInfo) {
-	struct huffmanNode* root = (struct huffmanNode*)malloc(sizeof(struct huffmanNode));
-	if (!root) {
-		printf("allocation failed\n");
+static struct huffmanTable* createTableFromLengths(const unsigned char* lengths, const unsigned char* elements, unsigned char htInfo) {
+	struct huffmanTable* table = (struct huffmanTable*)malloc(sizeof(struct huffmanTable));
+	if (!table) {
+		return NULL;
+	}
+	table->type = (htInfo > 0x0F) ? 1 : 0;
+	table->id = htInfo & 0x0F;
+	for (int i = 0; i < (1 << HUFFMAN_LOOKAHEAD); i++) {
+		table->lookahead[i] = 0;
 	}
-	root->type = (htInfo > 0x0F) ? 1 : 0;
-	root->id = htInfo & 0x0F;
-	root->data = 0xFF;
-	root->left = NULL;
-	root->right = NULL;
-	unsigned int code = 0;
+	int code = 0;
 	int k = 0;
-	for (int i = 0; i < 16; i++) {
-		int length = i + 1;
-		for (int j = 0; j < lengths[i]; j++) {
-			insertIntoTree(root, code, length, elements[k]);
+	for (int length = 1; length <= 16; length++) {
+		table->valptr[length] = k - code;
+		for (int j = 0; j < lengths[length - 1]; j++) {
+			table->values[k] = elements[k];
+			if (length <= HUFFMAN_LOOKAHEAD) {
+				int shift = HUFFMAN_LOOKAHEAD - length;
+				for (int fill = 0; fill < (1 << shift); fill++) {
+					table->lookahead[(code << shift) | fill] = (unsigned short)(length << 8 | elements[k]);
+				}
+			}
 			code++;
 			k++;
 		}
+		table->maxcode[length] = lengths[length - 1] ? code - 1 : -1;
 		code <<= 1;
 	}
-	return root;
+	table->maxcode[17] = 0x7FFFFFFF;
+	return table;
 }
 
-void deleteTree(struct huffmanNode* root) {
-	if (root == NULL) {
-		return;
+static int mapFile(const char* fileName, struct mappedFile* mapped) {
+#ifdef _WIN32
+	mapped->file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mapped->file == INVALID_HANDLE_VALUE) {
+		return 1;
 	}
-	deleteTree(root->left);
-	deleteTree(root->right);
-	free(root);
-}
-
-void printCodes(struct huffmanNode* root, int arr[], int top) {
-	if (root->left && root->right) {
-		arr[top] = 0;
-		printCodes(root->left, arr, top + 1);
-		arr[top] = 1;
-		printCodes(root->right, arr, top + 1);
-	} else if (root->left) {
-		arr[top] = 0;
-		printCodes(root->left, arr, top + 1);
-	} else if (root->right) {
-		arr[top] = 1;
-		printCodes(root->right, arr, top + 1);
-	}
-	if (root->data != 255) {
-		printf("%d: ", root->data);
-		for (int i = 0; i < top; i++) {
-			printf("%d", arr[i]);
-		}
-		printf("\n");
-	}
-}
-
-char readBit(FILE* img_ptr, unsigned char* currentBytes, char* offset, char* endFlag, char* endImgFlag, char* endScanFlag) {
-	char bit = (currentBytes[1] >> (7 - *offset)) & 1;
-	(*offset)++;
-	if (*offset == 8) {
-		*offset = 0;
-		currentBytes[1] = currentBytes[0];
-		size_t bytesRead = fread(currentBytes, 1, 1, img_ptr);
-		if (currentBytes[1] == 0xFF) {
-			if (currentBytes[0] == 0) {
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				if (bytesRead != 1) {
-					if (feof(img_ptr)) {
-						endFlag = 1;
-					}
-				}
-			} else {
-				printf("Marker found: %x, address: %x\n", currentBytes[1] << 8 | currentBytes[0], ftell(img_ptr));
-				if (currentBytes[0] == 0xD9) {
-					endImgFlag = 1;
-				}
-				endScanFlag = 1;
-				endFlag = 1;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mapped->file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(mapped->file);
+		return 1;
+	}
+	mapped->size = (size_t)fileSize.QuadPart;
+	mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapped->mapping) {
+		CloseHandle(mapped->file);
+		return 1;
+	}
+	mapped->data = MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!mapped->data) {
+		CloseHandle(mapped->mapping);
+		CloseHandle(mapped->file);
+		return 1;
+	}
+#else
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return 1;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return 1;
+	}
+	mapped->size = (size_t)info.st_size;
+	void* view = mmap(NULL, mapped->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+		return 1;
+	}
+	mapped->data = view;
+#endif
+	return 0;
+}
+
+static void unmapFile(struct mappedFile* mapped) {
+#ifdef _WIN32
+	UnmapViewOfFile(mapped->data);
+	CloseHandle(mapped->mapping);
+	CloseHandle(mapped->file);
+#else
+	munmap((void*)mapped->data, mapped->size);
+#endif
+}
+
+static void initBitReader(struct bitReader* reader, const unsigned char* data, size_t size, size_t pos) {
+	reader->data = data;
+	reader->size = size;
+	reader->pos = pos;
+	reader->acc = 0;
+	reader->bits = 0;
+	reader->marker = 0;
+	reader->markerFound = false;
+	reader->markerPos = size;
+}
+
+static int readEntropyByte(struct bitReader* reader) {
+	if (reader->pos >= reader->size) {
+		reader->markerFound = true;
+		reader->markerPos = reader->size;
+		return -1;
+	}
+	unsigned char byte = reader->data[reader->pos];
+	if (byte != 0xFF) {
+		reader->pos++;
+		return byte;
+	}
+	size_t next = reader->pos + 1;
+	while (next < reader->size && reader->data[next] == 0xFF) {
+		next++;
+	}
+	if (next < reader->size && reader->data[next] == 0) {
+		reader->pos = next + 1;
+		return 0xFF;
+	}
+	reader->marker = (next < reader->size) ? reader->data[next] : 0;
+	reader->markerFound = true;
+	reader->markerPos = next - 1;
+	return -1;
+}
+
+static void fillBits(struct bitReader* reader) {
+	while (reader->bits <= 56) {
+		int byte = reader->markerFound ? -1 : readEntropyByte(reader);
+		if (byte < 0) {
+			byte = 0;
+		}
+		reader->acc |= (uint64_t)byte << (56 - reader->bits);
+		reader->bits += 8;
+	}
+}
+
+static unsigned int peekBits(struct bitReader* reader, int count) {
+	if (reader->bits < count) {
+		fillBits(reader);
+	}
+	return (unsigned int)(reader->acc >> (64 - count));
+}
+
+static void consumeBits(struct bitReader* reader, int count) {
+	reader->acc <<= count;
+	reader->bits -= count;
+}
+
+static int getBits(struct bitReader* reader, int count) {
+	if (count == 0) {
+		return 0;
+	}
+	int value = peekBits(reader, count);
+	consumeBits(reader, count);
+	return value;
+}
+
+static int getBit(struct bitReader* reader) {
+	return getBits(reader, 1);
+}
+
+static size_t findMarker(struct bitReader* reader) {
+	while (!reader->markerFound) {
+		readEntropyByte(reader);
+	}
+	return reader->markerPos;
+}
+
+static int decodeHuffman(struct huffmanTable* table, struct bitReader* reader) {
+	unsigned int peek = peekBits(reader, 16);
+	unsigned short entry = table->lookahead[peek >> (16 - HUFFMAN_LOOKAHEAD)];
+	if (entry != 0) {
+		consumeBits(reader, entry >> 8);
+		return entry & 0xFF;
+	}
+	for (int length = HUFFMAN_LOOKAHEAD + 1; length <= 16; length++) {
+		int code = peek >> (16 - length);
+		if (code <= table->maxcode[length]) {
+			consumeBits(reader, length);
+			return table->values[table->valptr[length] + code];
+		}
+	}
+	consumeBits(reader, 16);
+	return -1;
+}
+
+static enum jpegStatus parseHuffmanTables(struct jpegDecoder* decoder, const unsigned char* segment, unsigned short length) {
+	int track = 0;
+	while (track + 17 <= length - 2) {
+		unsigned char htInfo = segment[track];
+		const unsigned char* lengths = segment + track + 1;
+		int numElements = 0;
+		int codes = 0;
+		for (int i = 0; i < 16; i++) {
+			numElements += lengths[i];
+			codes = codes * 2 + lengths[i];
+			if (codes > 1 << (i + 1)) {
+				return JPEG_ERROR_FORMAT;
 			}
 		}
+		if ((htInfo & 0x0F) > 3 || numElements > 256 || track + 17 + numElements > length - 2) {
+			return JPEG_ERROR_FORMAT;
+		}
+		struct huffmanTable* table = createTableFromLengths(lengths, segment + track + 17, htInfo);
+		if (!table) {
+			return JPEG_ERROR_MEMORY;
+		}
+		track += 17 + numElements;
+		if (table->type == 0) {
+			free(decoder->dcTables[table->id]);
+			decoder->dcTables[table->id] = table;
+		} else {
+			free(decoder->acTables[table->id]);
+			decoder->acTables[table->id] = table;
+		}
 	}
-	return bit;
+	return JPEG_OK;
 }
 
-int main(int argc, char* argv[]) {
-	const int startOfImage = 0xFFD8;
-	const int startOfFrame0 = 0xFFC0;
-	const int startOfFrame2 = 0xFFC2;
-	const int huffmanTable = 0xFFC4;
-	const int quantTable = 0xFFDB;
-	const int startOfScan = 0xFFDA;
-	const int endOfImage = 0xFFD9;
-	const char zigzag[8][8] =
-	{ {0, 1, 5, 6, 14, 15, 27, 28},
-	{2, 4, 7, 13, 16, 26, 29, 42},
-	{3, 8, 12, 17, 25, 30, 41, 43},
-	{9, 11, 18, 24, 31, 40, 44, 53},
-	{10, 19, 23, 32, 39, 45, 52, 54},
-	{20, 22, 33, 38, 46, 51, 55, 60},
-	{21, 34, 37, 47, 50, 56, 59, 61},
-	{35, 36, 48, 49, 57, 58, 62, 63} };
-	double idctTable[8][8];
-	char numComponents;
-	unsigned char numQTables;
-	struct component* components[3];
-	int idctPrecision;
-	char tableCount = 0;
-	char sfyh = 1, sfyv = 1, sfy = 1;
-	int qBlockNum = 0;
-	int eobrun = 0;
-	int totalBlocks;
-	struct pixelBlock* imgBlocks = NULL;
-	struct componentBlock* preTransBlocks = NULL;
-	struct componentBlock* out = NULL;
-	unsigned char* linearizedImg;
-	unsigned short height, trueHeight, width, trueWidth;
-	int yBlocksPerRow, yBlocksPerCol, totalYBlocks;
-	int cbBlocksPerRow, cbBlocksPerCol, totalCbBlocks;
-	int crBlocksPerRow, crBlocksPerCol, totalCrBlocks;
-	struct huffmanNode* dcTrees[8] = { NULL };
-	struct huffmanNode* acTrees[8] = { NULL };
-	struct quantTable* qtables[8] = { NULL };
-	unsigned char currentBytes[2];
-	size_t bytesRead;
-	char lengths[16];
-	FILE* img_ptr;
-	char* fileName = argv[1];
-	struct componentBlock* qBlocks = NULL;
-	struct component* currentComponent = NULL;
-	char sfcbh;
-	char sfcbv;
-	char sfcrh;
-	char sfcrv;
-	char cbRatioH;
-	char cbRatioV;
-	char crRatioH;
-	char crRatioV;
-	bool progressive;
-	SDL_Window* window = NULL;
-	SDL_Renderer* renderer = NULL;
-	SDL_Texture* texture = NULL;
-
-	errno_t fileError = fopen_s(&img_ptr, fileName, "rb");
-	if (fileError != 0) {
-		perror("Error opening file");
-		return 1;
+static enum jpegStatus parseQuantTables(struct jpegDecoder* decoder, const unsigned char* segment, unsigned short length) {
+	int track = 0;
+	while (track < length - 2) {
+		unsigned char qtInfo = segment[track];
+		int precision = qtInfo >> 4;
+		int id = qtInfo & 0x0F;
+		int entrySize = precision ? 2 : 1;
+		if (id > 3 || precision > 1 || track + 1 + 64 * entrySize > length - 2) {
+			return JPEG_ERROR_FORMAT;
+		}
+		if (!decoder->qtables[id]) {
+			decoder->qtables[id] = (struct quantTable*)malloc(sizeof(struct quantTable));
+			if (!decoder->qtables[id]) {
+				return JPEG_ERROR_MEMORY;
+			}
+		}
+		const unsigned char* values = segment + track + 1;
+		struct quantTable* qt = decoder->qtables[id];
+		for (int n = 0; n < 64; n++) {
+			int z = zigzag[n];
+			qt->natural[n] = precision ? (values[z * 2] << 8 | values[z * 2 + 1]) : values[z];
+			qt->scaled[n] = qt->natural[n] * aanScale[n];
+		}
+		track += 1 + 64 * entrySize;
 	}
-	while ((bytesRead = fread(currentBytes, 1, 1, img_ptr)) > 0) {
-		if (bytesRead == 1) {
-			unsigned short value = (unsigned char)currentBytes[1] << 8 | ((unsigned char)currentBytes[0]);
-			if (value == huffmanTable) {
-				bytesRead = fread(currentBytes, 1, 2, img_ptr);
-				unsigned short length = (unsigned char)currentBytes[0] << 8 | ((unsigned char)currentBytes[1]);
-				unsigned short track = 0;
-				while (track < length - 2) {
-					bytesRead = fread(currentBytes, 1, 1, img_ptr);
-					track++;
-					char htInfo = currentBytes[0];
-					int numElements = 0;
-					bytesRead = fread(lengths, 1, 16, img_ptr);
-					track += 16;
-					for (int i = 0; i < 16; i++) {
-						numElements += lengths[i];
-					}
-					char* elements = malloc(numElements);
-					bytesRead = fread(elements, 1, numElements, img_ptr);
-					track += numElements;
-					struct huffmanNode* tree = createTreeFromLengths(lengths, elements, htInfo);
-					int arr[16];
-					printCodes(tree, arr, 0);
-					if (tree->type == 0) {
-						dcTrees[tree->id] = tree;
-					} else {
-						acTrees[tree->id] = tree;
-					}
-					free(elements);
-					printf("\n");
-				}
-			} else if (value == quantTable) {
-				bytesRead = fread(currentBytes, 1, 2, img_ptr);
-				unsigned short length = (unsigned char)currentBytes[0] << 8 | ((unsigned char)currentBytes[1]);
-				numQTables = length / 64;
-				printf("there are %d quant tables\n", numQTables);
-				for (int i = 0; i < numQTables; i++) {
-					bytesRead = fread(currentBytes, 1, 1, img_ptr);
-					char qtinfo = currentBytes[0];
-					struct quantTable* qt = (struct quantTable*)malloc(sizeof(struct quantTable));
-					if (!qt) {
-						printf("allocation failed\n");
-					}
-					qt->info = qtinfo;
-					for (int j = 0; j < 8; j++) {
-						for (int k = 0; k < 8; k++) {
-							bytesRead = fread(currentBytes, 1, 1, img_ptr);
-							qt->data[j][k] = currentBytes[0];
-						}
-					}
-					qtables[tableCount++] = qt;
-				}
-			} else if (value == startOfFrame0 || value == startOfFrame2) {
-				progressive = false;
-				if (value == startOfFrame2) {
-					progressive = true;
-				}
-				bytesRead = fread(currentBytes, 1, 2, img_ptr);
-				unsigned short length = (unsigned char)currentBytes[0] << 8 | ((unsigned char)currentBytes[1]);
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				idctPrecision = currentBytes[0];
-				for (int u = 0; u < idctPrecision; u++) {
-					for (int v = 0; v < idctPrecision; v++) {
-						idctTable[u][v] = cos(((2.0 * v + 1.0) * u * 3.14159) / 16.0);
-					}
-				}
-				bytesRead = fread(currentBytes, 1, 2, img_ptr);
-				trueHeight = (unsigned char)currentBytes[0] << 8 | ((unsigned char)currentBytes[1]);
-				height = trueHeight;
-				while (height % 8 != 0) {
-					height++;
-				}
-				bytesRead = fread(currentBytes, 1, 2, img_ptr);
-				trueWidth = (unsigned char)currentBytes[0] << 8 | ((unsigned char)currentBytes[1]);
-				width = trueWidth;
-				while (width % 8 != 0) {
-					width++;
-				}
-				yBlocksPerRow = width / 8;
-				yBlocksPerCol = height / 8;
-				totalYBlocks = yBlocksPerRow * yBlocksPerCol;
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				numComponents = currentBytes[0];
-				for (int i = 0; i < numComponents; i++) {
-					struct component* newComponent = (struct component*)malloc(sizeof(struct component));
-					if (!newComponent) {
-						printf("allocation failed\n");
-					}
-					bytesRead = fread(currentBytes, 1, 1, img_ptr);
-					newComponent->id = currentBytes[0];
-					bytesRead = fread(currentBytes, 1, 1, img_ptr);
-					newComponent->samplingFactors = currentBytes[0];
-					bytesRead = fread(currentBytes, 1, 1, img_ptr);
-					newComponent->quantTable = currentBytes[0];
-					newComponent->oldDC = 0;
-					components[i] = newComponent;
-				}
-				sfyh = components[0]->samplingFactors >> 4 & 0x0F;
-				sfyv = components[0]->samplingFactors & 0x0F;
-				sfy = sfyh * sfyv;
-				sfcbh = components[1]->samplingFactors >> 4 & 0x0F;
-				sfcbv = components[1]->samplingFactors & 0x0F;
-				sfcrh = components[2]->samplingFactors >> 4 & 0x0F;
-				sfcrv = components[2]->samplingFactors & 0x0F;
-				cbRatioH = sfyh / sfcbh;
-				cbRatioV = sfyv / sfcbv;
-				crRatioH = sfyh / sfcrh;
-				crRatioV = sfyv / sfcrv;
-				cbBlocksPerRow = ceil((float)yBlocksPerRow / cbRatioH);
-				cbBlocksPerCol = ceil((float)yBlocksPerCol / cbRatioV);
-				totalCbBlocks = cbBlocksPerCol * cbBlocksPerRow;
-				crBlocksPerRow = ceil((float)yBlocksPerRow / crRatioH);
-				crBlocksPerCol = ceil((float)yBlocksPerCol / crRatioV);
-				totalCrBlocks = crBlocksPerCol * crBlocksPerRow;
-				totalBlocks = totalYBlocks + totalCbBlocks + totalCrBlocks;
-				qBlocks = malloc(sizeof(struct componentBlock) * totalBlocks);
-				for (int i = 0; i < (totalYBlocks + totalCbBlocks + totalCrBlocks); i++) {
-					for (int j = 0; j < 8; j++) {
-						for (int k = 0; k < 8; k++) {
-							qBlocks[i].pixels[j][k] = 0;
-						}
-					}
-					if (i < totalYBlocks) {
-						qBlocks[i].componentId = 1;
-					} else if (i < totalYBlocks + totalCbBlocks) {
-						qBlocks[i].componentId = 2;
-					} else if (i < totalBlocks) {
-						qBlocks[i].componentId = 3;
-					} else {
-						qBlocks[i].componentId = 0;
-					}
-				}
-				out = malloc(sizeof(struct componentBlock) * totalBlocks);
-				for (int i = 0; i < totalBlocks; i++) {
-					for (int j = 0; j < 8; j++) {
-						for (int k = 0; k < 8; k++) {
-							out[i].pixels[j][k] = 0;
-						}
-					}
-				}
-				preTransBlocks = malloc(sizeof(struct componentBlock) * totalBlocks);
-				for (int i = 0; i < totalBlocks; i++) {
-					for (int j = 0; j < 8; j++) {
-						for (int k = 0; k < 8; k++) {
-							preTransBlocks[i].pixels[j][k] = 0;
-						}
+	return JPEG_OK;
+}
+
+static enum jpegStatus parseFrame(struct jpegDecoder* decoder, const unsigned char* segment, unsigned short length, bool progressive) {
+	if (decoder->frameRead || length < 8) {
+		return JPEG_ERROR_FORMAT;
+	}
+	if (segment[0] != 8) {
+		return JPEG_ERROR_UNSUPPORTED;
+	}
+	int trueHeight = segment[1] << 8 | segment[2];
+	int trueWidth = segment[3] << 8 | segment[4];
+	int numComponents = segment[5];
+	if (trueHeight == 0 || trueWidth == 0 || length < 8 + numComponents * 3) {
+		return JPEG_ERROR_FORMAT;
+	}
+	if (numComponents != 1 && numComponents != 3) {
+		return JPEG_ERROR_UNSUPPORTED;
+	}
+	int maxH = 1;
+	int maxV = 1;
+	for (int i = 0; i < numComponents; i++) {
+		struct component* newComponent = &decoder->components[i];
+		newComponent->id = segment[6 + i * 3];
+		newComponent->samplingFactors = segment[7 + i * 3];
+		newComponent->quantTable = segment[8 + i * 3];
+		newComponent->h = newComponent->samplingFactors >> 4 & 0x0F;
+		newComponent->v = newComponent->samplingFactors & 0x0F;
+		if (newComponent->h < 1 || newComponent->h > 4 || newComponent->v < 1 || newComponent->v > 4 || newComponent->quantTable > 3) {
+			return JPEG_ERROR_FORMAT;
+		}
+		maxH = newComponent->h > maxH ? newComponent->h : maxH;
+		maxV = newComponent->v > maxV ? newComponent->v : maxV;
+	}
+	if (numComponents == 1) {
+		decoder->components[0].h = 1;
+		decoder->components[0].v = 1;
+		maxH = 1;
+		maxV = 1;
+	}
+	if (decoder->components[0].h != maxH || decoder->components[0].v != maxV) {
+		return JPEG_ERROR_UNSUPPORTED;
+	}
+	decoder->numComponents = numComponents;
+	decoder->mcusPerLine = (trueWidth + 8 * maxH - 1) / (8 * maxH);
+	decoder->mcusPerColumn = (trueHeight + 8 * maxV - 1) / (8 * maxV);
+	for (int i = 0; i < numComponents; i++) {
+		struct component* newComponent = &decoder->components[i];
+		if (maxH % newComponent->h != 0 || maxV % newComponent->v != 0) {
+			return JPEG_ERROR_UNSUPPORTED;
+		}
+		newComponent->ratioH = maxH / newComponent->h;
+		newComponent->ratioV = maxV / newComponent->v;
+		newComponent->blocksPerLine = decoder->mcusPerLine * newComponent->h;
+		newComponent->blocksPerColumn = decoder->mcusPerColumn * newComponent->v;
+		newComponent->scanBlocksPerLine = ((trueWidth + newComponent->ratioH - 1) / newComponent->ratioH + 7) / 8;
+		newComponent->scanBlocksPerColumn = ((trueHeight + newComponent->ratioV - 1) / newComponent->ratioV + 7) / 8;
+	}
+	int scale = decoder->options.scaleDenominator;
+	decoder->blockSize = 8 / scale;
+	decoder->info.width = (trueWidth + scale - 1) / scale;
+	decoder->info.height = (trueHeight + scale - 1) / scale;
+	decoder->info.imageWidth = trueWidth;
+	decoder->info.imageHeight = trueHeight;
+	decoder->marginX = 0;
+	decoder->marginY = 0;
+	decoder->contextRows = 0;
+	for (int i = 0; i < numComponents; i++) {
+		struct component* newComponent = &decoder->components[i];
+		int ratioH = newComponent->ratioH;
+		int ratioV = newComponent->ratioV;
+		newComponent->sampleWidth = (trueWidth + ratioH * scale - 1) / (ratioH * scale);
+		newComponent->sampleHeight = (trueHeight + ratioV * scale - 1) / (ratioV * scale);
+		bool fancy = decoder->options.upsampleMethod == UPSAMPLE_FANCY && decoder->options.pixelFormat != PIXEL_GRAY8 && decoder->options.pixelFormat != PIXEL_YUV_RAW && decoder->blockSize > 1;
+		newComponent->fancyH = fancy && ratioH == 2 && ratioV <= 2 && newComponent->sampleWidth > 2;
+		newComponent->fancyV = fancy && ratioV == 2 && (ratioH == 1 || newComponent->fancyH);
+		if (newComponent->fancyH) {
+			decoder->marginX = 2 * ratioH > decoder->marginX ? 2 * ratioH : decoder->marginX;
+		}
+		if (newComponent->fancyV) {
+			decoder->marginY = 2 * ratioV > decoder->marginY ? 2 * ratioV : decoder->marginY;
+			decoder->contextRows = 1;
+		}
+	}
+	decoder->cropX = 0;
+	decoder->cropY = 0;
+	decoder->cropWidth = decoder->info.width;
+	decoder->cropHeight = decoder->info.height;
+	decoder->info.components = numComponents;
+	decoder->info.progressive = progressive;
+	decoder->frameRead = true;
+	return JPEG_OK;
+}
+
+static void* allocateAligned(size_t size) {
+#ifdef _WIN32
+	return _aligned_malloc(size, 32);
+#else
+	return aligned_alloc(32, (size + 31) / 32 * 32);
+#endif
+}
+
+static void freeAligned(void* memory) {
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+static enum jpegStatus allocateBlocks(struct jpegDecoder* decoder, bool streaming) {
+	decoder->streaming = streaming;
+	decoder->totalBlocks = 0;
+	int stages = streaming && !decoder->pulling && !decoder->options.regionComplete ? threadCount(decoder->pool) : 1;
+	decoder->pipelineStages = stages < PIPELINE_STAGES ? stages : PIPELINE_STAGES;
+	int ringRows = 1 + 2 * decoder->contextRows + (decoder->pipelineStages > 1 ? PIPELINE_ROWS : 0);
+	for (int c = 0; c < decoder->numComponents; c++) {
+		struct component* component = &decoder->components[c];
+		component->storedBlockRows = streaming ? component->v * ringRows : component->blocksPerColumn;
+		component->firstBlock = decoder->totalBlocks;
+		decoder->totalBlocks += component->blocksPerLine * component->storedBlockRows;
+		size_t size = (size_t)component->blocksPerLine * component->storedBlockRows * 64 * sizeof(short);
+		component->coefficients = allocateAligned(size);
+		if (!component->coefficients) {
+			return JPEG_ERROR_MEMORY;
+		}
+		memset(component->coefficients, 0, size);
+	}
+	size_t rowWidth = (size_t)decoder->components[0].blocksPerLine * 8;
+	decoder->out = calloc(decoder->totalBlocks, sizeof(struct componentBlock));
+	decoder->rowBuffer = malloc(sizeof(short) * 3 * rowWidth);
+	decoder->sampleRows = malloc(sizeof(short) * 2 * (rowWidth + 16));
+	decoder->dirtyBlocks = malloc(decoder->totalBlocks);
+	decoder->blockExtents = calloc(decoder->totalBlocks, 1);
+	decoder->dirtyColumns = malloc(sizeof(int) * 2 * decoder->components[0].blocksPerColumn);
+	if (!decoder->out || !decoder->rowBuffer || !decoder->sampleRows || !decoder->dirtyBlocks || !decoder->blockExtents || !decoder->dirtyColumns) {
+		return JPEG_ERROR_MEMORY;
+	}
+	memset(decoder->dirtyBlocks, 1, decoder->totalBlocks);
+	return JPEG_OK;
+}
+
+static int pixelSize(enum pixelFormat format) {
+	if (format == PIXEL_RGB24) {
+		return 3;
+	}
+	return format == PIXEL_RGBA32 || format == PIXEL_BGRA32 ? 4 : 1;
+}
+
+static int blockIndex(const struct component* component, int blockRow, int blockColumn) {
+	return component->firstBlock + blockRow % component->storedBlockRows * component->blocksPerLine + blockColumn;
+}
+
+static int findComponent(struct jpegDecoder* decoder, unsigned char id) {
+	for (int i = 0; i < decoder->numComponents; i++) {
+		if (decoder->components[i].id == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int extendValue(int value, int bits) {
+	if (bits > 0 && value < (1 << (bits - 1))) {
+		value -= (1 << bits) - 1;
+	}
+	return value;
+}
+
+static bool refineCoefficient(struct bitReader* reader, short* coefficient, int bit) {
+	if (!getBit(reader) || (*coefficient & bit) != 0) {
+		return false;
+	}
+	*coefficient += *coefficient > 0 ? bit : -bit;
+	return true;
+}
+
+static void decodeBlock(const struct scanContext* scan, struct scanState* state, int componentIndex, int block) {
+	struct jpegDecoder* decoder = scan->decoder;
+	struct component* component = &decoder->components[componentIndex];
+	struct bitReader* reader = &state->reader;
+	short* coefficients = component->coefficients + (size_t)(block - component->firstBlock) * 64;
+	unsigned char* extent = &decoder->blockExtents[block];
+	int ss = scan->ss;
+	int se = scan->se;
+	int al = scan->al;
+	bool changed = false;
+	if (scan->ah == 0) {
+		if (state->eobrun > 0) {
+			state->eobrun--;
+			return;
+		}
+		changed = true;
+		if (ss == 0) {
+			if (!decoder->info.progressive) {
+				memset(coefficients, 0, 64 * sizeof(short));
+				*extent = 0;
+			}
+			int symbol = decodeHuffman(decoder->dcTables[component->dcTable], reader);
+			int category = (symbol < 0) ? 0 : symbol & 0x0F;
+			int predictor = state->dcPredictors[componentIndex] + extendValue(getBits(reader, category), category);
+			state->dcPredictors[componentIndex] = ((predictor + 32768) & 0xFFFF) - 32768;
+			coefficients[0] = (short)(state->dcPredictors[componentIndex] * (1 << al));
+		}
+		struct huffmanTable* acTable = decoder->acTables[component->acTable];
+		for (int j = (ss > 0) ? ss : 1; j <= se; j++) {
+			int symbol = decodeHuffman(acTable, reader);
+			if (symbol < 0) {
+				break;
+			}
+			int category = symbol & 0x0F;
+			int runLength = symbol >> 4;
+			if (category == 0) {
+				if (runLength != 0x0F) {
+					if (decoder->info.progressive) {
+						state->eobrun = (1 << runLength) + getBits(reader, runLength) - 1;
 					}
+					break;
 				}
-				currentComponent = components[0];
-				int errorCode = SDL_Init(SDL_INIT_VIDEO);
-				if (errorCode != 0) {
-					window = SDL_CreateWindow(fileName, width, height, 0);
-					renderer = SDL_CreateRenderer(window, NULL);
-					texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STATIC, width, height);
-				} else {
-					printf("SDL failed to initialize\n");
-					printf("%s\n", SDL_GetError());
-				}
-			} else if (value == startOfScan) {
-				printf("Scan started at %x\n", ftell(img_ptr));
-				bytesRead = fread(currentBytes, 1, 2, img_ptr);
-				unsigned short length = (unsigned char)currentBytes[0] << 8 | ((unsigned char)currentBytes[1]);
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				char numComponentsScan = currentBytes[0];
-				char componentId = 0;
-				for (int g = 0; g < numComponentsScan; g++) {
-					bytesRead = fread(currentBytes, 1, 1, img_ptr);
-					componentId = currentBytes[0];
-					bytesRead = fread(currentBytes, 1, 1, img_ptr);
-					char tableNums = currentBytes[0];
-					components[componentId - 1]->dcTable = (tableNums >> 4) & 0x0F;
-					components[componentId - 1]->acTable = tableNums & 0x0F;
-				}
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				char ss = currentBytes[0];
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				char se = currentBytes[0];
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				char ah = currentBytes[0] >> 4 & 0x0F;
-				char al = currentBytes[0] & 0x0F;
-				printf("ss: %d se: %d ah: %d al: %d, numComponentsScan: %d, componentId: %d\n", ss, se, ah, al, numComponentsScan, componentId);
-				char endFlag = 0;
-				char endImgFlag = 0;
-				char endScanFlag = 0;
-				imgBlocks = malloc(sizeof(struct pixelBlock) * totalYBlocks);
-				if (!imgBlocks) {
-					printf("allocation failed\n");
+				j += 15;
+				continue;
+			}
+			j += runLength;
+			if (j > se) {
+				break;
+			}
+			coefficients[naturalOrder[j]] = (short)(extendValue(getBits(reader, category), category) * (1 << al));
+			if (*extent < j) {
+				*extent = (unsigned char)j;
+			}
+		}
+	} else if (ss == 0) {
+		if (getBit(reader)) {
+			coefficients[0] = (short)(coefficients[0] | (1 << al));
+			changed = true;
+		}
+	} else {
+		int bit = 1 << al;
+		int j = ss;
+		if (state->eobrun == 0) {
+			struct huffmanTable* acTable = decoder->acTables[component->acTable];
+			for (; j <= se; j++) {
+				int symbol = decodeHuffman(acTable, reader);
+				if (symbol < 0) {
+					break;
 				}
-				int blocks = 0;
-				char offset = 0;;
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				currentBytes[1] = currentBytes[0];
-				bytesRead = fread(currentBytes, 1, 1, img_ptr);
-				if (bytesRead != 1) {
-					if (feof(img_ptr)) {
-						endFlag = 1;
-					}
+				int category = symbol & 0x0F;
+				int runLength = symbol >> 4;
+				int value = 0;
+				if (category != 0) {
+					value = getBit(reader) ? bit : -bit;
+				} else if (runLength != 0x0F) {
+					state->eobrun = (1 << runLength) + getBits(reader, runLength);
 					break;
 				}
-				if (currentBytes[1] == 0xFF) {
-					if (currentBytes[0] == 0) {
-						bytesRead = fread(currentBytes, 1, 1, img_ptr);
-						if (bytesRead != 1) {
-							if (feof(img_ptr)) {
-								endFlag = 1;
-							}
-							break;
-						}
-					} else {
-						printf("Marker found: %x, address: %x\n", currentBytes[1] << 8 | currentBytes[0], ftell(img_ptr));
-						if (currentBytes[0] == 0xD9) {
-							endImgFlag = 1;
-						}
-						endScanFlag = 1;
-						endFlag = 1;
+				for (; j <= se; j++) {
+					short* coefficient = &coefficients[naturalOrder[j]];
+					if (*coefficient != 0) {
+						changed |= refineCoefficient(reader, coefficient, bit);
+					} else if (runLength-- == 0) {
 						break;
 					}
 				}
-				if (componentId == 1 || numComponentsScan == numComponents) {
-					qBlockNum = 0;
-				} else if (componentId == 2) {
-					qBlockNum = totalYBlocks;
-				} else if (componentId == 3) {
-					qBlockNum = totalYBlocks + totalCbBlocks;
-				}
-				if (numComponentsScan == 1) {
-					if (componentId == 1) {
-						blocks = totalYBlocks;
-					} else if (componentId == 2) {
-						blocks = totalCbBlocks;
-					} else if (componentId == 3) {
-						blocks = totalCrBlocks;
+				if (value != 0 && j <= se) {
+					coefficients[naturalOrder[j]] = (short)value;
+					if (*extent < j) {
+						*extent = (unsigned char)j;
 					}
-				} else if (numComponentsScan == 3) {
-					blocks = totalBlocks;
-					componentId = 1;
+					changed = true;
 				}
-				currentComponent = components[componentId - 1];
-				for (int x = 0; x < blocks; x++) {
-					if (!endImgFlag && !endScanFlag) {
-						if (!endFlag) {
-							int idctBase[8][8];
-							int qtnum = currentComponent->quantTable;
-							struct quantTable* qt = qtables[qtnum];
-							char sampleFactorH = currentComponent->samplingFactors >> 4 & 0x0F;
-							char sampleFactorV = currentComponent->samplingFactors & 0x0F;
-							for (int a = 0; a < 8; a++) {
-								for (int b = 0; b < 8; b++) {
-									idctBase[a][b] = 0;
-								}
-							}
-							preTransBlocks[qBlockNum].componentId = currentComponent->id;
-							if (eobrun == 0) {
-								if (ss == 0) {
-									if (ah == 0) {
-										struct huffmanNode* dcTree = dcTrees[currentComponent->dcTable];
-										struct huffmanNode* node = dcTree;
-										while (node->data == 0xFF) {
-											char bit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-											if (bit != 0 && (node->right)) {
-												node = node->right;
-											} else if (bit == 0 && node->left) {
-												node = node->left;
-											} else {
-												idctBase[0][0] = 0;
-											}
-										}
-										char category = node->data & 0x0F;
-										int magnitude = 0;
-										for (int t = 0; t < category; t++) {
-											char bit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-											magnitude = (magnitude << 1) | bit;
-										}
-										if (magnitude < (1 << (category - 1))) {
-											magnitude -= (1 << category) - 1;
-										}
-										int newdc = currentComponent->oldDC + magnitude;
-										idctBase[0][0] = newdc;
-										currentComponent->oldDC = newdc;
-									} else {
-										char bit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-										qBlocks[qBlockNum].pixels[0][0] = (int)qBlocks[qBlockNum].pixels[0][0] | (bit << al);
-									}
-								}
-								unsigned char nodeData = 0;
-								struct huffmanNode* acTree = acTrees[currentComponent->acTable];
-								struct huffmanNode* node;
-								if (se > 0) {
-									int start = (ss > 0) ? ss : 1;
-									for (int j = start; j <= se; j++) {
-										node = acTree;
-										while (node->data == 0xFF) {
-											char bit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-											if (bit != 0 && (node->right)) {
-												node = node->right;
-											} else if (bit == 0 && (node->left)) {
-												node = node->left;
-											} else {
-												while (j < 64) {
-													idctBase[j / 8][j % 8] = 0;
-													j++;
-												}
-												break;
-											}
-											nodeData = node->data;
-										}
-										if (endScanFlag || endImgFlag || endFlag) {
-											break;
-										}
-										char category = nodeData & 0x0F;
-										char runLength = (nodeData >> 4) & 0x0F;
-										if (ah == 0 && category != 0) {
-											for (int q = 0; q < runLength; q++) {
-												if (j > se) {
-													break;
-												}
-												idctBase[j / 8][j % 8] = 0;
-												j++;
-											}
-										}
-										if (ah == 0 && nodeData == 0xF0) {
-											for (int q = 0; q < 16; q++) {
-												if (j > se) {
-													break;
-												}
-												idctBase[j / 8][j % 8] = 0;
-												j++;
-											}
-											j--;
-											continue;
-										}
-										if (category == 0 && runLength != 0x0F) {
-											if (progressive) {
-												int v = 0;
-												for (int p = 0; p < runLength; p++) {
-													char bit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-													v = (v << 1) | bit;
-												}
-												if (!endScanFlag) {
-													eobrun = (1 << runLength) + v - 1;
-													preTransBlocks[qBlockNum].componentId = currentComponent->id;
-													if (ah > 0) {
-														while (j <= se) {
-															int a = j / 8;
-															int b = j % 8;
-															if (qBlocks[qBlockNum].pixels[a][b] != 0) {
-																char refineBit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);;
-																if (refineBit) {
-																	if (qBlocks[qBlockNum].pixels[a][b] > 0) {
-																		qBlocks[qBlockNum].pixels[a][b] += 1 << al;
-																	} else {
-																		qBlocks[qBlockNum].pixels[a][b] -= 1 << al;
-																	}
-																}
-															}
-															j++;
-														}
-													}
-													break;
-												}
-											} else {
-												while (j < 64) {
-													idctBase[j / 8][j % 8] = 0;
-													j++;
-												}
-											}
-											break;
-										}
-										int magnitude = 0;
-										if (j >= ss && j <= se) {
-											if (ah == 0) {
-												for (int t = 0; t < category; t++) {
-													char bit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-													magnitude = (magnitude << 1) | bit;
-												}
-												if (magnitude < (1 << (category - 1))) {
-													magnitude -= (1 << category) - 1;
-												}
-												idctBase[j / 8][j % 8] = magnitude;
-											} else {
-												if (category == 1) {
-													int f = runLength;
-													char extraBit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);;
-													int a = j / 8;
-													int b = j % 8;
-													while ((f > 0 || qBlocks[qBlockNum].pixels[a][b] != 0) && (j <= se)) {
-														if (qBlocks[qBlockNum].pixels[a][b] != 0) {
-															char refineBit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-															if (refineBit) {
-																if (qBlocks[qBlockNum].pixels[a][b] > 0) {
-																	qBlocks[qBlockNum].pixels[a][b] += 1 << al;
-																} else {
-																	qBlocks[qBlockNum].pixels[a][b] -= 1 << al;
-																}
-															}
-														} else {
-															f--;
-														}
-														j++;
-														a = j / 8;
-														b = j % 8;
-													}
-													if (j <= se) {
-														if (extraBit != 0) {
-															qBlocks[qBlockNum].pixels[a][b] = 1 << al;
-														} else {
-															qBlocks[qBlockNum].pixels[a][b] = -(1 << al);
-														}
-													}
-													continue;
-												} else if (category == 0) {
-													int f = runLength;
-													if (runLength == 0x0F) {
-														f++;
-													}
-													while (f > 0 && j <= se) {
-														int a = j / 8;
-														int b = j % 8;
-														if (qBlocks[qBlockNum].pixels[a][b] != 0) {
-															char refineBit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-															if (refineBit) {
-																if (qBlocks[qBlockNum].pixels[a][b] > 0) {
-																	qBlocks[qBlockNum].pixels[a][b] += 1 << al;
-																} else {
-																	qBlocks[qBlockNum].pixels[a][b] -= 1 << al;
-																}
-															}
-														} else {
-															f--;
-														}
-														j++;
-													}
-													j--;
-													continue;
-												}
-											}
-										}
-									}
-								}		
-								for (int j = se + 1; j < 64; j++) {
-									idctBase[j / 8][j % 8] = 0;
-								}
-								if (!progressive || (se == 0 && ah == 0)) {
-									for (int a = 0; a < 8; a++) {
-										for (int b = 0; b < 8; b++) {
-											idctBase[a][b] <<= al;
-										}
-									}
-									if (!progressive) {
-										for (int a = 0; a < 8; a++) {
-											for (int b = 0; b < 8; b++) {
-												idctBase[a][b] = idctBase[a][b] * qt->data[a][b];
-											}
-										}
-									}
-									for (int a = 0; a < 8; a++) {
-										for (int b = 0; b < 8; b++) {
-											qBlocks[qBlockNum].pixels[a][b] = idctBase[a][b];
-											if (!progressive) {
-												preTransBlocks[qBlockNum].pixels[a][b] = idctBase[zigzag[a][b] / 8][zigzag[a][b] % 8];
-											}
-										}
-									}
-								} else {
-									if (ah == 0) {
-										for (int index = ss; index <= se; index++) {
-											int a = index / 8;
-											int b = index % 8;
-											qBlocks[qBlockNum].pixels[a][b] = idctBase[a][b] << al;
-										}
-									}
-								}
-								if (progressive) {
-									for (int index = 0; index < 64; index++) {
-										int a = index / 8;
-										int b = index % 8;
-										preTransBlocks[qBlockNum].pixels[a][b] = qBlocks[qBlockNum].pixels[zigzag[a][b] / 8][zigzag[a][b] % 8] * qt->data[zigzag[a][b] / 8][zigzag[a][b] % 8];
-									}
-								}
-								preTransBlocks[qBlockNum].componentId = currentComponent->id;
-							} else {
-								if (ah > 0) {
-									for (int index = ss; index <= se; index++) {
-										int a = index / 8;
-										int b = index % 8;
-										if (qBlocks[qBlockNum].pixels[a][b] != 0) {
-											char refineBit = readBit(img_ptr, currentBytes, &offset, &endFlag, &endImgFlag, &endScanFlag);
-											if (refineBit) {
-												if (qBlocks[qBlockNum].pixels[a][b] > 0) {
-													qBlocks[qBlockNum].pixels[a][b] += 1 << al;
-												} else {
-													qBlocks[qBlockNum].pixels[a][b] -= 1 << al;
-												}
-											}
-										}
-									}
-								}
-								for (int index = 0; index < 64; index++) {
-									int a = index / 8;
-									int b = index % 8;
-									preTransBlocks[qBlockNum].pixels[a][b] = qBlocks[qBlockNum].pixels[zigzag[a][b] / 8][zigzag[a][b] % 8] * qt->data[zigzag[a][b] / 8][zigzag[a][b] % 8];
-								}
-								preTransBlocks[qBlockNum].componentId = currentComponent->id;
-								eobrun--;
-							}
-							if (numComponentsScan == 1) {
-								if (currentComponent->id == 1) {
-									qBlockNum = x + 1;
-								} else if (currentComponent->id == 2) {
-									qBlockNum = totalYBlocks + x + 1;
-								} else if (currentComponent->id == 3) {
-									qBlockNum = totalYBlocks + totalCbBlocks + x + 1;
-								}
-							} else if (numComponentsScan == 3) {
-								int mcuPos = (x + 1) % (sfy + sfcbh * sfcbv + sfcrh * sfcrv);
-								if (mcuPos == 0 || mcuPos == sfy || mcuPos == sfy + sfcbh * sfcbv) {
-									currentComponent = components[currentComponent->id % numComponents];
-								}
-								int mcuNum = (x + 1) / (sfy + sfcbh * sfcbv + sfcrh * sfcrv);
-								int loc = (x + 1) % (sfy + sfcbh * sfcbv + sfcrh * sfcrv);
-								int mcuCols = (yBlocksPerRow + sfyh - 1) / sfyh;
-								if (currentComponent->id == 1) {
-									qBlockNum = (mcuNum / mcuCols * sfyv + loc / sfyh) * yBlocksPerRow + (mcuNum % mcuCols * sfyh) + loc % sfyh;
-									if (qBlockNum >= totalYBlocks) {
-										break;
-									}
-								} else if (currentComponent->id == 2) {
-									qBlockNum = totalYBlocks + (x + 1) / (sfy + sfcbh * sfcbv + sfcrh * sfcrv);
-									if (qBlockNum >= totalYBlocks + totalCbBlocks) {
-										break;
-									}
-								} else if (currentComponent->id == 3) {
-									qBlockNum = totalYBlocks + totalCbBlocks + (x + 1) / (sfy + sfcbh * sfcbv + sfcrh * sfcrv);
-									if (qBlockNum >= totalBlocks) {
-										break;
-									}
-								}
-							}
-						} else {
-							printf("end of file found\n");
-							break;
-						}
-						fflush(stdout);
-					} else {
-						printf("end of scan\n");					
-						break;
-					}
+			}
+		}
+		if (state->eobrun > 0) {
+			for (; j <= se; j++) {
+				short* coefficient = &coefficients[naturalOrder[j]];
+				if (*coefficient != 0) {
+					changed |= refineCoefficient(reader, coefficient, bit);
 				}
-				printf("Scan ended at %x\n", ftell(img_ptr));
-				fflush(stdout);
-				for (int x = 0; x < totalBlocks; x++) {
-					for (int a = 0; a < 8; a++) {
-						for (int b = 0; b < 8; b++) {
-							float localSum = 0.0;
-							for (int u = 0; u < 8; u++) {
-								for (int v = 0; v < 8; v++) {
-									float normCoeff = 1.0;
-									if (u == 0) {
-										normCoeff *= 1.0 / sqrt(2.0);
-									}
-									if (v == 0) {
-										normCoeff *= 1.0 / sqrt(2.0);
-									}
-									localSum += normCoeff * preTransBlocks[x].pixels[u][v] * idctTable[u][a] * idctTable[v][b];
-								}
-							}
-							out[x].pixels[a][b] = round(localSum / 4.0) + 128.0;
-						}
+			}
+			state->eobrun--;
+		}
+	}
+	if (changed) {
+		decoder->dirtyBlocks[block] = 1;
+	}
+}
+
+static void decodeMcus(const struct scanContext* scan, struct scanState* state, int firstMcu, int lastMcu) {
+	struct jpegDecoder* decoder = scan->decoder;
+	for (int mcu = firstMcu; mcu < lastMcu; mcu++) {
+		if (scan->componentsInScan == 1) {
+			int componentIndex = scan->scanComponents[0];
+			struct component* component = &decoder->components[componentIndex];
+			int row = mcu / component->scanBlocksPerLine;
+			int col = mcu % component->scanBlocksPerLine;
+			decodeBlock(scan, state, componentIndex, blockIndex(component, row, col));
+		} else {
+			int mcuRow = mcu / decoder->mcusPerLine;
+			int mcuCol = mcu % decoder->mcusPerLine;
+			for (int s = 0; s < scan->componentsInScan; s++) {
+				int componentIndex = scan->scanComponents[s];
+				struct component* component = &decoder->components[componentIndex];
+				for (int v = 0; v < component->v; v++) {
+					int row = blockIndex(component, mcuRow * component->v + v, mcuCol * component->h);
+					for (int h = 0; h < component->h; h++) {
+						decodeBlock(scan, state, componentIndex, row + h);
 					}
-					out[x].componentId = preTransBlocks[x].componentId;
 				}
-				for (int yBlock = 0; yBlock < totalYBlocks; yBlock++) {
-					int yBlockX = yBlock % yBlocksPerRow;
-					int yBlockY = yBlock / yBlocksPerRow;
-					int cbBlock = (yBlockY / cbRatioV) * cbBlocksPerRow + yBlockX / cbRatioH;
-					int crBlock = (yBlockY / crRatioV) * crBlocksPerRow + yBlockX / crRatioH;
-					for (int index = 0; index < 64; index++) {
-						int yPosX = index % 8;
-						int yPosY = index / 8;
-						float Y = out[yBlock].pixels[yPosX][yPosY];
-						int cbPosX = ((yBlockY * 8 + yPosX) / cbRatioH) % 8;
-						int cbPosY = ((yBlockX * 8 + yPosY) / cbRatioV) % 8;
-						float Cb = out[totalYBlocks + cbBlock].pixels[cbPosX][cbPosY];
-						int crPosX = ((yBlockY * 8 + yPosX) / crRatioH) % 8;
-						int crPosY = ((yBlockX * 8 + yPosY) / crRatioV) % 8;
-						float Cr = out[totalYBlocks + totalCbBlocks + crBlock].pixels[crPosX][crPosY];
-						float R = Y + 1.402 * (Cr - 128.0);
-						float G = Y - 0.344136 * (Cb - 128.0) - 0.714136 * (Cr - 128.0);
-						float B = Y + 1.772 * (Cb - 128.0);
-						imgBlocks[yBlock].pixelsR[yPosX][yPosY] = (unsigned char)(R < 0 ? 0 : R > 255 ? 255 : round(R));
-						imgBlocks[yBlock].pixelsG[yPosX][yPosY] = (unsigned char)(G < 0 ? 0 : G > 255 ? 255 : round(G));
-						imgBlocks[yBlock].pixelsB[yPosX][yPosY] = (unsigned char)(B < 0 ? 0 : B > 255 ? 255 : round(B));
-					}
+			}
+		}
+	}
+}
+
+static void initScanState(struct scanState* state, struct jpegDecoder* decoder, size_t pos) {
+	initBitReader(&state->reader, decoder->data, decoder->size, pos);
+	state->eobrun = 0;
+	state->skipping = false;
+	for (int i = 0; i < 3; i++) {
+		state->dcPredictors[i] = 0;
+	}
+}
+
+static size_t nextMarker(const unsigned char* data, size_t size, size_t pos) {
+	while (pos < size) {
+		const unsigned char* found = memchr(data + pos, 0xFF, size - pos);
+		if (!found) {
+			break;
+		}
+		size_t next = found - data + 1;
+		while (next < size && data[next] == 0xFF) {
+			next++;
+		}
+		if (next < size && data[next] != 0) {
+			return next - 1;
+		}
+		pos = next + 1;
+	}
+	return size;
+}
+
+static int indexRestartMarkers(const unsigned char* data, size_t size, size_t pos, size_t* starts, int maxSegments, size_t* end) {
+	int segments = 1;
+	starts[0] = pos;
+	for (pos = nextMarker(data, size, pos); pos + 1 < size && data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7; pos = nextMarker(data, size, pos + 2)) {
+		if (segments < maxSegments) {
+			starts[segments] = pos + 2;
+		}
+		segments++;
+	}
+	*end = pos;
+	return segments;
+}
+
+static size_t skipScan(const unsigned char* data, size_t size, size_t pos) {
+	size_t start;
+	size_t end;
+	indexRestartMarkers(data, size, pos, &start, 1, &end);
+	return end;
+}
+
+static bool mcusVisible(const struct scanContext* scan, int firstMcu, int lastMcu) {
+	for (int mcu = firstMcu; mcu < lastMcu;) {
+		int row = mcu / scan->mcusPerLine;
+		if (row > scan->cropBottom) {
+			break;
+		}
+		int rowEnd = (row + 1) * scan->mcusPerLine;
+		int firstColumn = mcu - row * scan->mcusPerLine;
+		int lastColumn = (rowEnd < lastMcu ? rowEnd : lastMcu) - 1 - row * scan->mcusPerLine;
+		if (row >= scan->cropTop && firstColumn <= scan->cropRight && lastColumn >= scan->cropLeft) {
+			return true;
+		}
+		mcu = rowEnd;
+	}
+	return false;
+}
+
+static void decodeRestartInterval(void* context, int index) {
+	const struct scanContext* scan = (const struct scanContext*)context;
+	int interval = scan->decoder->restartInterval;
+	int lastMcu = (index + 1) * interval;
+	if (!mcusVisible(scan, index * interval, lastMcu < scan->totalMcus ? lastMcu : scan->totalMcus)) {
+		return;
+	}
+	double start = currentTime();
+	struct scanState state;
+	initScanState(&state, scan->decoder, scan->segmentStarts[index]);
+	decodeMcus(scan, &state, index * interval, lastMcu < scan->totalMcus ? lastMcu : scan->totalMcus);
+	scan->segmentSeconds[index] = currentTime() - start;
+}
+
+static void notifyRegions(struct jpegDecoder* decoder, int firstRow, int lastRow) {
+	int* columns = decoder->dirtyColumns;
+	for (int row = firstRow; row < lastRow;) {
+		if (columns[row * 2] > columns[row * 2 + 1]) {
+			row++;
+			continue;
+		}
+		int bandRow = row;
+		int firstColumn = columns[row * 2];
+		int lastColumn = columns[row * 2 + 1];
+		for (row++; row < lastRow && columns[row * 2] <= columns[row * 2 + 1]; row++) {
+			firstColumn = columns[row * 2] < firstColumn ? columns[row * 2] : firstColumn;
+			lastColumn = columns[row * 2 + 1] > lastColumn ? columns[row * 2 + 1] : lastColumn;
+		}
+		int size = decoder->blockSize;
+		int left = firstColumn * size > decoder->cropX ? firstColumn * size : decoder->cropX;
+		int top = bandRow * size > decoder->cropY ? bandRow * size : decoder->cropY;
+		int right = (lastColumn + 1) * size < decoder->cropX + decoder->cropWidth ? (lastColumn + 1) * size : decoder->cropX + decoder->cropWidth;
+		int bottom = row * size < decoder->cropY + decoder->cropHeight ? row * size : decoder->cropY + decoder->cropHeight;
+		decoder->options.regionComplete(decoder->options.user, decoder->output, decoder->stride, left - decoder->cropX, top - decoder->cropY, right - left, bottom - top);
+	}
+}
+
+static void inverseTransform(struct jpegDecoder* decoder, const short* coefficients, const struct quantTable* qt, int extent, short output[8][8]) {
+	const struct kernels* kernels = &decoder->kernels;
+	if (decoder->options.idctMethod == IDCT_REFERENCE) {
+		idctReference(coefficients, qt->natural, decoder->blockSize, output);
+	} else if (decoder->blockSize == 4) {
+		idctScaled4x4(coefficients, qt->natural, output);
+	} else if (decoder->blockSize == 2) {
+		idctScaled2x2(coefficients, qt->natural, output);
+	} else if (decoder->blockSize == 1) {
+		idctScaled1x1(coefficients, qt->natural, output);
+	} else if (decoder->options.idctMethod == IDCT_FLOAT) {
+		if (extent == 0) {
+			idctFloatDc(coefficients, qt->scaled, output);
+		} else if (extent <= IDCT_EXTENT_2X2) {
+			kernels->idctFloat2x2(coefficients, qt->scaled, output);
+		} else if (extent <= IDCT_EXTENT_4X4) {
+			kernels->idctFloat4x4(coefficients, qt->scaled, output);
+		} else {
+			kernels->idctFloat(coefficients, qt->scaled, output);
+		}
+	} else if (extent == 0) {
+		idctIntegerDc(coefficients, qt->natural, output);
+	} else if (extent <= IDCT_EXTENT_2X2) {
+		kernels->idctInteger2x2(coefficients, qt->natural, output);
+	} else if (extent <= IDCT_EXTENT_4X4) {
+		kernels->idctInteger4x4(coefficients, qt->natural, output);
+	} else {
+		kernels->idctInteger(coefficients, qt->natural, output);
+	}
+}
+
+static bool regionDirty(const struct jpegDecoder* decoder, const struct component* component, int top, int bottom, int left, int right) {
+	int unitWidth = decoder->blockSize * component->ratioH;
+	int unitHeight = decoder->blockSize * component->ratioV;
+	int firstRow = top > 0 ? top / unitHeight : 0;
+	int lastRow = (bottom - 1) / unitHeight < component->blocksPerColumn ? (bottom - 1) / unitHeight : component->blocksPerColumn - 1;
+	int firstColumn = left > 0 ? left / unitWidth : 0;
+	int lastColumn = (right - 1) / unitWidth < component->blocksPerLine ? (right - 1) / unitWidth : component->blocksPerLine - 1;
+	for (int row = firstRow; row <= lastRow; row++) {
+		const unsigned char* dirty = decoder->dirtyBlocks + blockIndex(component, row, 0);
+		for (int column = firstColumn; column <= lastColumn; column++) {
+			if (dirty[column]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void gatherSamples(const struct jpegDecoder* decoder, const struct component* component, int sampleY, int first, int last, short* samples) {
+	int size = decoder->blockSize;
+	const struct componentBlock* blocks = decoder->out + blockIndex(component, sampleY / size, 0);
+	for (int column = first / size; column <= last / size; column++) {
+		memcpy(samples + column * size, blocks[column].pixels[sampleY % size], size * sizeof(short));
+	}
+}
+
+static void upsampleRow(struct jpegDecoder* decoder, const struct component* component, int y, int xStart, int xEnd, short* output) {
+	const struct kernels* kernels = &decoder->kernels;
+	int ratioH = component->ratioH;
+	int first = xStart / ratioH;
+	int last = (xEnd - 1) / ratioH;
+	int sampleY = y / component->ratioV;
+	int gatherFirst = component->fancyH && first > 0 ? first - 1 : first;
+	int gatherLast = component->fancyH && last + 1 < component->sampleWidth ? last + 1 : last;
+	short* samples = ratioH == 1 ? output : decoder->sampleRows + 8;
+	gatherSamples(decoder, component, sampleY, gatherFirst, gatherLast, samples);
+	if (component->fancyV) {
+		short* far = decoder->sampleRows + (size_t)decoder->components[0].blocksPerLine * 8 + 24;
+		int farY = y % 2 ? sampleY + 1 : sampleY - 1;
+		farY = farY < 0 ? 0 : farY < component->sampleHeight ? farY : component->sampleHeight - 1;
+		gatherSamples(decoder, component, farY, gatherFirst, gatherLast, far);
+		kernels->fancyUpsampleV2(samples + gatherFirst, far + gatherFirst, samples + gatherFirst, gatherLast - gatherFirst + 1, component->fancyH ? 0 : 2);
+	}
+	if (component->fancyH) {
+		if (first == 0) {
+			samples[-1] = samples[0];
+		}
+		if (last + 1 == component->sampleWidth) {
+			samples[last + 1] = samples[last];
+		}
+		kernels->fancyUpsampleH2(samples + first, output + first * 2, last - first + 1, component->fancyV ? 4 : 2);
+	} else if (ratioH == 2) {
+		kernels->replicateH2(samples + first, output + first * 2, last - first + 1);
+	} else if (ratioH > 2) {
+		for (int i = first; i <= last; i++) {
+			for (int k = 0; k < ratioH; k++) {
+				output[i * ratioH + k] = samples[i];
+			}
+		}
+	}
+}
+
+static void clearDirtyRows(struct jpegDecoder* decoder, int firstRow, int lastRow) {
+	for (int c = 0; c < decoder->numComponents; c++) {
+		struct component* component = &decoder->components[c];
+		int lastBlockRow = (lastRow + component->ratioV - 1) / component->ratioV;
+		for (int blockRow = firstRow / component->ratioV; blockRow < lastBlockRow; blockRow++) {
+			memset(decoder->dirtyBlocks + blockIndex(component, blockRow, 0), 0, component->blocksPerLine);
+		}
+	}
+}
+
+static void renderPlanes(struct jpegDecoder* decoder, int firstRow, int lastRow) {
+	struct componentBlock* out = decoder->out;
+	unsigned char* dirty = decoder->dirtyBlocks;
+	short* samples = decoder->rowBuffer;
+	unsigned char* plane = decoder->output;
+	int size = decoder->blockSize;
+	for (int c = 0; c < decoder->numComponents; c++) {
+		struct component* component = &decoder->components[c];
+		int left = decoder->cropX / component->ratioH;
+		int right = (decoder->cropX + decoder->cropWidth + component->ratioH - 1) / component->ratioH;
+		int top = decoder->cropY / component->ratioV;
+		int bottom = (decoder->cropY + decoder->cropHeight + component->ratioV - 1) / component->ratioV;
+		int first = (firstRow * size + component->ratioV - 1) / component->ratioV;
+		int last = (lastRow * size + component->ratioV - 1) / component->ratioV;
+		first = first > top ? first : top;
+		last = last < bottom ? last : bottom;
+		for (int y = first; y < last; y++) {
+			int rowStart = blockIndex(component, y / size, 0);
+			int firstColumn = left / size;
+			int lastColumn = (right - 1) / size;
+			while (firstColumn <= lastColumn && !dirty[rowStart + firstColumn]) {
+				firstColumn++;
+			}
+			while (lastColumn >= firstColumn && !dirty[rowStart + lastColumn]) {
+				lastColumn--;
+			}
+			for (int column = firstColumn; column <= lastColumn; column++) {
+				memcpy(samples + column * size, out[rowStart + column].pixels[y % size], size * sizeof(short));
+			}
+			int xStart = firstColumn * size > left ? firstColumn * size : left;
+			int xEnd = (lastColumn + 1) * size < right ? (lastColumn + 1) * size : right;
+			if (xStart < xEnd) {
+				decoder->kernels.storeSamples(samples + xStart, plane + (size_t)(y - top) * decoder->stride + (xStart - left), xEnd - xStart);
+			}
+		}
+		plane += decoder->stride * (bottom - top);
+	}
+}
+
+static bool clampRows(const struct jpegDecoder* decoder, int* firstRow, int* lastRow) {
+	int size = decoder->blockSize;
+	int top = decoder->cropY / size;
+	int bottom = (decoder->cropY + decoder->cropHeight - 1) / size + 1;
+	*firstRow = *firstRow > top ? *firstRow : top;
+	*lastRow = *lastRow < bottom ? *lastRow : bottom;
+	return *firstRow < *lastRow;
+}
+
+static void transformRows(struct jpegDecoder* decoder, int firstRow, int lastRow, bool context) {
+	struct componentBlock* out = decoder->out;
+	unsigned char* dirty = decoder->dirtyBlocks;
+	int size = decoder->blockSize;
+	int components = decoder->options.pixelFormat == PIXEL_GRAY8 ? 1 : decoder->numComponents;
+	if (!clampRows(decoder, &firstRow, &lastRow)) {
+		return;
+	}
+	for (int c = 0; c < components; c++) {
+		struct component* component = &decoder->components[c];
+		struct quantTable* qt = decoder->qtables[component->quantTable];
+		int unitWidth = size * component->ratioH;
+		int unitHeight = size * component->ratioV;
+		int marginX = component->fancyH ? 2 * component->ratioH : 0;
+		int marginY = context && component->fancyV ? 2 * component->ratioV : 0;
+		int top = firstRow * size - marginY;
+		int left = decoder->cropX - marginX;
+		int firstBlockRow = top > 0 ? top / unitHeight : 0;
+		int lastBlockRow = (lastRow * size + marginY - 1) / unitHeight + 1;
+		lastBlockRow = lastBlockRow < component->blocksPerColumn ? lastBlockRow : component->blocksPerColumn;
+		int firstBlockColumn = left > 0 ? left / unitWidth : 0;
+		int lastBlockColumn = (decoder->cropX + decoder->cropWidth + marginX - 1) / unitWidth;
+		lastBlockColumn = lastBlockColumn < component->blocksPerLine ? lastBlockColumn : component->blocksPerLine - 1;
+		for (int blockRow = firstBlockRow; qt && blockRow < lastBlockRow; blockRow++) {
+			int rowStart = blockIndex(component, blockRow, 0);
+			for (int x = rowStart + firstBlockColumn; x <= rowStart + lastBlockColumn; x++) {
+				if (!(dirty[x] & 1)) {
+					continue;
 				}
-				linearizedImg = malloc(3 * height * width);
-				if (!linearizedImg) {
-					printf("allocation failed\n");
+				const short* coefficients = component->coefficients + (size_t)(x - component->firstBlock) * 64;
+				inverseTransform(decoder, coefficients, qt, decoder->blockExtents[x], out[x].pixels);
+				dirty[x] = 2;
+			}
+		}
+	}
+}
+
+static void renderRows(struct jpegDecoder* decoder, struct jpegStats* stats, int firstRow, int lastRow) {
+	struct componentBlock* out = decoder->out;
+	unsigned char* dirty = decoder->dirtyBlocks;
+	int* columns = decoder->dirtyColumns;
+	struct component* luma = &decoder->components[0];
+	struct component* cb = &decoder->components[1];
+	struct component* cr = &decoder->components[2];
+	int size = decoder->blockSize;
+	int cropLeft = decoder->cropX / size;
+	int cropRight = (decoder->cropX + decoder->cropWidth - 1) / size;
+	if (!clampRows(decoder, &firstRow, &lastRow)) {
+		return;
+	}
+	enum pixelFormat format = decoder->options.pixelFormat;
+	int components = format == PIXEL_GRAY8 ? 1 : decoder->numComponents;
+	double start = currentTime();
+	transformRows(decoder, firstRow, lastRow, true);
+	double transformed = currentTime();
+	stats->idctSeconds += transformed - start;
+	if (format == PIXEL_YUV_RAW) {
+		renderPlanes(decoder, firstRow, lastRow);
+		clearDirtyRows(decoder, firstRow, lastRow);
+		stats->colorSeconds += currentTime() - transformed;
+		if (decoder->options.regionComplete && !decoder->pulling) {
+			notifyRegions(decoder, firstRow, lastRow);
+		}
+		return;
+	}
+	for (int yBlockY = firstRow; yBlockY < lastRow; yBlockY++) {
+		columns[yBlockY * 2] = luma->scanBlocksPerLine;
+		columns[yBlockY * 2 + 1] = -1;
+		for (int yBlockX = cropLeft; yBlockX <= cropRight; yBlockX++) {
+			bool changed = dirty[blockIndex(luma, yBlockY, yBlockX)] != 0;
+			for (int c = 1; c < components && !changed; c++) {
+				struct component* component = &decoder->components[c];
+				int marginX = component->fancyH ? 2 * component->ratioH : 0;
+				int marginY = component->fancyV ? 2 * component->ratioV : 0;
+				changed = regionDirty(decoder, component, yBlockY * size - marginY, (yBlockY + 1) * size + marginY, yBlockX * size - marginX, (yBlockX + 1) * size + marginX);
+			}
+			if (changed) {
+				if (columns[yBlockY * 2] > yBlockX) {
+					columns[yBlockY * 2] = yBlockX;
 				}
-				int count = 0;
-				for (int y = 0; y < yBlocksPerCol; y++) {
-					for (int y2 = 0; y2 < 8; y2++) {
-						for (int x = 0; x < yBlocksPerRow; x++) {
-							int blockPos = yBlocksPerRow * y + x;
-							for (int x2 = 0; x2 < 8; x2++) {
-								unsigned char rValue = imgBlocks[blockPos].pixelsR[y2][x2];
-								unsigned char gValue = imgBlocks[blockPos].pixelsG[y2][x2];
-								unsigned char bValue = imgBlocks[blockPos].pixelsB[y2][x2];
-								linearizedImg[count++] = rValue;
-								linearizedImg[count++] = gValue;
-								linearizedImg[count++] = bValue;
-							}
-						}
-					}
+				columns[yBlockY * 2 + 1] = yBlockX;
+			}
+		}
+	}
+	clearDirtyRows(decoder, firstRow, lastRow);
+	size_t rowWidth = (size_t)luma->blocksPerLine * 8;
+	short* yRow = decoder->rowBuffer;
+	short* cbRow = yRow + rowWidth;
+	short* crRow = cbRow + rowWidth;
+	int pixelBytes = pixelSize(format);
+	size_t planeSize = decoder->stride * decoder->cropHeight;
+	int cropEnd = decoder->cropX + decoder->cropWidth;
+	int firstY = firstRow * size > decoder->cropY ? firstRow * size : decoder->cropY;
+	int lastY = lastRow * size < decoder->cropY + decoder->cropHeight ? lastRow * size : decoder->cropY + decoder->cropHeight;
+	for (int y = firstY; y < lastY; y++) {
+		int firstColumn = columns[y / size * 2];
+		int lastColumn = columns[y / size * 2 + 1];
+		if (lastColumn < 0) {
+			continue;
+		}
+		int xStart = firstColumn * size > decoder->cropX ? firstColumn * size : decoder->cropX;
+		int xEnd = (lastColumn + 1) * size < cropEnd ? (lastColumn + 1) * size : cropEnd;
+		struct componentBlock* yBlocks = out + blockIndex(luma, y / size, 0);
+		for (int column = firstColumn; column <= lastColumn; column++) {
+			memcpy(yRow + column * size, yBlocks[column].pixels[y % size], size * sizeof(short));
+		}
+		unsigned char* pixel = decoder->output + (size_t)(y - decoder->outputOrigin) * decoder->stride + (size_t)(xStart - decoder->cropX) * pixelBytes;
+		int count = xEnd - xStart;
+		if (format == PIXEL_GRAY8) {
+			decoder->kernels.storeSamples(yRow + xStart, pixel, count);
+		} else if (decoder->numComponents == 1 && format == PIXEL_YUV_PLANAR) {
+			decoder->kernels.storeSamples(yRow + xStart, pixel, count);
+			memset(pixel + planeSize, 128, count);
+			memset(pixel + 2 * planeSize, 128, count);
+		} else if (decoder->numComponents == 1) {
+			decoder->kernels.expandGray(yRow + xStart, pixel, count, format);
+		} else if (format == PIXEL_YUV_PLANAR) {
+			upsampleRow(decoder, cb, y, xStart, xEnd, cbRow);
+			upsampleRow(decoder, cr, y, xStart, xEnd, crRow);
+			decoder->kernels.storeSamples(yRow + xStart, pixel, count);
+			decoder->kernels.storeSamples(cbRow + xStart, pixel + planeSize, count);
+			decoder->kernels.storeSamples(crRow + xStart, pixel + 2 * planeSize, count);
+		} else {
+			upsampleRow(decoder, cb, y, xStart, xEnd, cbRow);
+			upsampleRow(decoder, cr, y, xStart, xEnd, crRow);
+			decoder->kernels.colorConvert(yRow + xStart, cbRow + xStart, crRow + xStart, pixel, count, format);
+		}
+	}
+	stats->colorSeconds += currentTime() - transformed;
+	if (decoder->options.regionComplete && !decoder->pulling) {
+		notifyRegions(decoder, firstRow, lastRow);
+	}
+}
+
+static void renderMcuRow(struct jpegDecoder* decoder, struct jpegStats* stats, int mcuRow) {
+	struct component* luma = &decoder->components[0];
+	int firstRow = mcuRow * luma->v;
+	int lastRow = firstRow + luma->v < luma->scanBlocksPerColumn ? firstRow + luma->v : luma->scanBlocksPerColumn;
+	renderRows(decoder, stats, firstRow, lastRow);
+}
+
+static bool waitForRows(struct pipeline* pipeline, int stage, int row, int lookahead) {
+	mtx_lock(&pipeline->lock);
+	while (pipeline->rows[stage] <= row + lookahead && !pipeline->done[stage]) {
+		cnd_wait(&pipeline->progress, &pipeline->lock);
+	}
+	bool ready = pipeline->rows[stage] > row;
+	mtx_unlock(&pipeline->lock);
+	return ready;
+}
+
+static void publishRows(struct pipeline* pipeline, int stage, int rows, bool done) {
+	mtx_lock(&pipeline->lock);
+	pipeline->rows[stage] = rows;
+	pipeline->done[stage] = done;
+	cnd_broadcast(&pipeline->progress);
+	mtx_unlock(&pipeline->lock);
+}
+
+static void beginPipelineRow(struct jpegDecoder* decoder, int mcuRow) {
+	struct pipeline* pipeline = decoder->pipeline;
+	int ringRows = 1 + 2 * decoder->contextRows + PIPELINE_ROWS;
+	publishRows(pipeline, 0, mcuRow, false);
+	double start = currentTime();
+	waitForRows(pipeline, pipeline->stages - 1, mcuRow - ringRows + decoder->contextRows, 0);
+	pipeline->stallSeconds += currentTime() - start;
+}
+
+static void completeImage(struct jpegDecoder* decoder) {
+	if (decoder->options.scanComplete && !decoder->pulling) {
+		decoder->options.scanComplete(decoder->options.user, decoder->output, decoder->cropWidth, decoder->cropHeight, decoder->stride);
+	}
+}
+
+static void continueScan(struct jpegDecoder* decoder, int maxRows) {
+	struct scanContext* scan = &decoder->scan;
+	struct scanState* state = &decoder->scanState;
+	struct jpegStats* stats = &decoder->stats;
+	double pixelSeconds = stats->idctSeconds + stats->colorSeconds;
+	double start = currentTime();
+	int interval = decoder->restartInterval > 0 ? decoder->restartInterval : scan->totalMcus;
+	int step = decoder->streaming ? decoder->mcusPerLine : scan->totalMcus;
+	int rows = 0;
+	int mcu = decoder->nextMcu;
+	int endMcu = (scan->cropBottom + 1) * scan->mcusPerLine;
+	endMcu = endMcu < scan->totalMcus ? endMcu : scan->totalMcus;
+	while (mcu < endMcu && rows < maxRows) {
+		if (decoder->pipeline && mcu % step == 0) {
+			beginPipelineRow(decoder, mcu / step);
+		}
+		if (mcu % interval == 0) {
+			if (mcu > 0) {
+				size_t marker = findMarker(&state->reader);
+				if (marker + 1 < decoder->size && decoder->data[marker + 1] >= 0xD0 && decoder->data[marker + 1] <= 0xD7) {
+					marker += 2;
 				}
-				SDL_UpdateTexture(texture, NULL, linearizedImg, 3 * width);
-				SDL_RenderClear(renderer);
-				SDL_RenderTexture(renderer, texture, NULL, NULL);
-				SDL_RenderPresent(renderer);
-				SDL_Delay(1000);
-				free(linearizedImg);
-				do {
-					fseek(img_ptr, -1L, SEEK_CUR);
-					fread(currentBytes, 1, 1, img_ptr);
-					fseek(img_ptr, -1L, SEEK_CUR);
-				} while (currentBytes[0] != 0xFF);
-			} else if (value == endOfImage) {
-				break;
+				initScanState(state, decoder, marker);
+			}
+			int intervalEnd = mcu + interval < scan->totalMcus ? mcu + interval : scan->totalMcus;
+			state->skipping = decoder->restartInterval > 0 && !mcusVisible(scan, mcu, intervalEnd);
+			if (state->skipping) {
+				initBitReader(&state->reader, decoder->data, decoder->size, nextMarker(decoder->data, decoder->size, state->reader.pos));
+			}
+		}
+		int lastMcu = (mcu / interval + 1) * interval;
+		int rowEnd = (mcu / step + 1) * step;
+		lastMcu = lastMcu < rowEnd ? lastMcu : rowEnd;
+		lastMcu = lastMcu < scan->totalMcus ? lastMcu : scan->totalMcus;
+		if (!state->skipping) {
+			decodeMcus(scan, state, mcu, lastMcu);
+		}
+		mcu = lastMcu;
+		if (mcu % step == 0 || mcu == scan->totalMcus) {
+			rows++;
+		}
+		if (decoder->streaming && !decoder->pulling && !decoder->pipeline && mcu % step == 0 && mcu / step > decoder->contextRows) {
+			renderMcuRow(decoder, stats, mcu / step - 1 - decoder->contextRows);
+		}
+	}
+	decoder->nextMcu = mcu;
+	if (mcu >= endMcu) {
+		if (decoder->streaming && !decoder->pulling && !decoder->pipeline && decoder->contextRows > 0) {
+			renderMcuRow(decoder, stats, mcu / step - 1);
+		}
+		size_t marker = findMarker(&state->reader);
+		decoder->pos = mcu < scan->totalMcus ? skipScan(decoder->data, decoder->size, marker) : marker;
+		decoder->scanActive = false;
+	}
+	stats->entropySeconds += currentTime() - start - (stats->idctSeconds + stats->colorSeconds - pixelSeconds);
+}
+
+static void runPipelineStage(void* context, int index) {
+	struct jpegDecoder* decoder = (struct jpegDecoder*)context;
+	struct pipeline* pipeline = decoder->pipeline;
+	struct component* luma = &decoder->components[0];
+	if (index == 0) {
+		continueScan(decoder, INT_MAX);
+		publishRows(pipeline, 0, (decoder->nextMcu + decoder->mcusPerLine - 1) / decoder->mcusPerLine, true);
+		return;
+	}
+	bool render = index == pipeline->stages - 1;
+	int row = 0;
+	for (; waitForRows(pipeline, index - 1, row, render ? decoder->contextRows : 0); row++) {
+		if (render) {
+			renderMcuRow(decoder, &pipeline->stats[index], row);
+		} else {
+			double start = currentTime();
+			int lastRow = (row + 1) * luma->v < luma->scanBlocksPerColumn ? (row + 1) * luma->v : luma->scanBlocksPerColumn;
+			transformRows(decoder, row * luma->v, lastRow, false);
+			pipeline->stats[index].idctSeconds += currentTime() - start;
+		}
+		publishRows(pipeline, index, row + 1, false);
+	}
+	publishRows(pipeline, index, row, true);
+}
+
+static enum jpegStatus pipelineScan(struct jpegDecoder* decoder) {
+	struct pipeline pipeline;
+	memset(&pipeline, 0, sizeof(pipeline));
+	if (mtx_init(&pipeline.lock, mtx_plain) != thrd_success) {
+		return JPEG_ERROR_MEMORY;
+	}
+	if (cnd_init(&pipeline.progress) != thrd_success) {
+		mtx_destroy(&pipeline.lock);
+		return JPEG_ERROR_MEMORY;
+	}
+	pipeline.stages = decoder->pipelineStages;
+	decoder->pipeline = &pipeline;
+	struct jpegStats* stats = &decoder->stats;
+	double stageSeconds = stats->entropySeconds + stats->idctSeconds + stats->colorSeconds;
+	double start = currentTime();
+	runTasks(decoder->pool, pipeline.stages, runPipelineStage, decoder);
+	decoder->parallelSeconds += currentTime() - start;
+	decoder->pipeline = NULL;
+	stats->entropySeconds -= pipeline.stallSeconds;
+	for (int i = 1; i < pipeline.stages; i++) {
+		stats->idctSeconds += pipeline.stats[i].idctSeconds;
+		stats->colorSeconds += pipeline.stats[i].colorSeconds;
+	}
+	decoder->parallelStageSeconds += stats->entropySeconds + stats->idctSeconds + stats->colorSeconds - stageSeconds;
+	cnd_destroy(&pipeline.progress);
+	mtx_destroy(&pipeline.lock);
+	return JPEG_OK;
+}
+
+static enum jpegStatus decodeScan(struct jpegDecoder* decoder, const unsigned char* segment, unsigned short length, size_t entropyStart) {
+	struct scanContext scan;
+	scan.decoder = decoder;
+	if (length < 8) {
+		return JPEG_ERROR_FORMAT;
+	}
+	scan.componentsInScan = segment[0];
+	if (scan.componentsInScan < 1 || scan.componentsInScan > decoder->numComponents || length < 6 + scan.componentsInScan * 2) {
+		return JPEG_ERROR_FORMAT;
+	}
+	const unsigned char* spectral = segment + 1 + scan.componentsInScan * 2;
+	scan.ss = spectral[0];
+	scan.se = spectral[1];
+	scan.ah = spectral[2] >> 4 & 0x0F;
+	scan.al = spectral[2] & 0x0F;
+	if (scan.se > 63 || scan.ss > scan.se || scan.ah > 13 || scan.al > 13) {
+		return JPEG_ERROR_FORMAT;
+	}
+	if (decoder->info.progressive && scan.ah != 0 && scan.ah != scan.al + 1) {
+		return JPEG_ERROR_FORMAT;
+	}
+	for (int g = 0; g < scan.componentsInScan; g++) {
+		int componentIndex = findComponent(decoder, segment[1 + g * 2]);
+		if (componentIndex < 0) {
+			return JPEG_ERROR_FORMAT;
+		}
+		struct component* scanComponent = &decoder->components[componentIndex];
+		scanComponent->dcTable = segment[2 + g * 2] >> 4 & 0x0F;
+		scanComponent->acTable = segment[2 + g * 2] & 0x0F;
+		if (scanComponent->dcTable > 3 || scanComponent->acTable > 3 || !decoder->qtables[scanComponent->quantTable]) {
+			return JPEG_ERROR_FORMAT;
+		}
+		if ((scan.ss == 0 && scan.ah == 0 && !decoder->dcTables[scanComponent->dcTable]) || (scan.se > 0 && !decoder->acTables[scanComponent->acTable])) {
+			return JPEG_ERROR_FORMAT;
+		}
+		scan.scanComponents[g] = componentIndex;
+	}
+	int mcuWidth = decoder->blockSize * decoder->components[0].h;
+	int mcuHeight = decoder->blockSize * decoder->components[0].v;
+	if (scan.componentsInScan == 1) {
+		struct component* component = &decoder->components[scan.scanComponents[0]];
+		scan.totalMcus = component->scanBlocksPerLine * component->scanBlocksPerColumn;
+		scan.mcusPerLine = component->scanBlocksPerLine;
+		mcuWidth = decoder->blockSize * component->ratioH;
+		mcuHeight = decoder->blockSize * component->ratioV;
+	} else {
+		scan.totalMcus = decoder->mcusPerLine * decoder->mcusPerColumn;
+		scan.mcusPerLine = decoder->mcusPerLine;
+	}
+	int left = decoder->cropX - decoder->marginX;
+	int top = decoder->cropY - decoder->marginY;
+	scan.cropLeft = left > 0 ? left / mcuWidth : 0;
+	scan.cropRight = (decoder->cropX + decoder->cropWidth + decoder->marginX - 1) / mcuWidth;
+	scan.cropTop = top > 0 ? top / mcuHeight : 0;
+	scan.cropBottom = (decoder->cropY + decoder->cropHeight + decoder->marginY - 1) / mcuHeight;
+	int interval = decoder->restartInterval > 0 ? decoder->restartInterval : scan.totalMcus;
+	int intervals = (scan.totalMcus + interval - 1) / interval;
+	if (!decoder->out) {
+		bool streaming = !decoder->info.progressive && scan.componentsInScan == decoder->numComponents && !(decoder->pool && intervals > 1);
+		enum jpegStatus status = allocateBlocks(decoder, streaming);
+		if (status != JPEG_OK) {
+			return status;
+		}
+	}
+	if (decoder->blockSize == 1 && scan.ss > 0) {
+		decoder->pos = skipScan(decoder->data, decoder->size, entropyStart);
+		return JPEG_OK;
+	}
+	if (decoder->pool && intervals > 1 && !decoder->streaming) {
+		size_t* starts = (size_t*)malloc(sizeof(size_t) * intervals);
+		double* seconds = (double*)calloc(intervals, sizeof(double));
+		if (!starts || !seconds) {
+			free(starts);
+			free(seconds);
+			return JPEG_ERROR_MEMORY;
+		}
+		size_t end;
+		if (indexRestartMarkers(decoder->data, decoder->size, entropyStart, starts, intervals, &end) == intervals) {
+			double start = currentTime();
+			scan.segmentStarts = starts;
+			scan.segmentSeconds = seconds;
+			runTasks(decoder->pool, intervals, decodeRestartInterval, &scan);
+			decoder->parallelSeconds += currentTime() - start;
+			for (int i = 0; i < intervals; i++) {
+				decoder->stats.entropySeconds += seconds[i];
+				decoder->parallelStageSeconds += seconds[i];
+			}
+			decoder->pos = end;
+			free(starts);
+			free(seconds);
+			return JPEG_OK;
+		}
+		free(starts);
+		free(seconds);
+	}
+	decoder->scan = scan;
+	initScanState(&decoder->scanState, decoder, entropyStart);
+	decoder->nextMcu = 0;
+	decoder->scanActive = true;
+	return JPEG_OK;
+}
+
+static enum jpegStatus processSegments(struct jpegDecoder* decoder, bool headerOnly) {
+	const int startOfImage = 0xFFD8;
+	const int startOfFrame0 = 0xFFC0;
+	const int startOfFrame1 = 0xFFC1;
+	const int startOfFrame2 = 0xFFC2;
+	const int huffmanTable = 0xFFC4;
+	const int quantTable = 0xFFDB;
+	const int restartInterval = 0xFFDD;
+	const int startOfScan = 0xFFDA;
+	const int endOfImage = 0xFFD9;
+	const unsigned char* data = decoder->data;
+	size_t size = decoder->size;
+	bool rendered = true;
+	while (decoder->pos + 1 < size) {
+		size_t pos = decoder->pos;
+		if (data[pos] != 0xFF || data[pos + 1] == 0xFF || data[pos + 1] == 0) {
+			decoder->pos++;
+			continue;
+		}
+		unsigned short value = data[pos] << 8 | data[pos + 1];
+		pos += 2;
+		decoder->pos = pos;
+		if (value == endOfImage) {
+			break;
+		}
+		if (value == startOfImage || (value >= 0xFFD0 && value <= 0xFFD7)) {
+			continue;
+		}
+		if (pos + 2 > size || pos + (data[pos] << 8 | data[pos + 1]) > size) {
+			return JPEG_ERROR_FORMAT;
+		}
+		unsigned short length = data[pos] << 8 | data[pos + 1];
+		const unsigned char* segment = data + pos + 2;
+		enum jpegStatus status = JPEG_OK;
+		if (length < 2) {
+			return JPEG_ERROR_FORMAT;
+		}
+		if (value == huffmanTable) {
+			status = parseHuffmanTables(decoder, segment, length);
+		} else if (value == quantTable) {
+			status = parseQuantTables(decoder, segment, length);
+		} else if (value == restartInterval) {
+			if (length < 4) {
+				return JPEG_ERROR_FORMAT;
+			}
+			decoder->restartInterval = segment[0] << 8 | segment[1];
+		} else if (value == startOfFrame0 || value == startOfFrame1 || value == startOfFrame2) {
+			status = parseFrame(decoder, segment, length, value == startOfFrame2);
+			if (status == JPEG_OK && headerOnly) {
+				decoder->pos = pos + length;
+				return JPEG_OK;
+			}
+		} else if ((value >= 0xFFC3 && value <= 0xFFCF) && value != 0xFFC8 && value != 0xFFCC) {
+			return JPEG_ERROR_UNSUPPORTED;
+		} else if (value == startOfScan) {
+			if (!decoder->frameRead || headerOnly) {
+				return JPEG_ERROR_FORMAT;
+			}
+			status = decodeScan(decoder, segment, length, pos + length);
+			if (status != JPEG_OK) {
+				return status;
+			}
+			decoder->scans++;
+			if (decoder->scanActive && decoder->streaming && decoder->pulling) {
+				return JPEG_OK;
+			}
+			if (decoder->scanActive && decoder->streaming && decoder->pipelineStages > 1) {
+				status = pipelineScan(decoder);
+				if (status != JPEG_OK) {
+					return status;
+				}
+			} else if (decoder->scanActive) {
+				continueScan(decoder, INT_MAX);
+			}
+			if (decoder->pulling) {
+				continue;
+			}
+			if (decoder->info.progressive && decoder->options.progressiveMode != PROGRESSIVE_FINAL) {
+				if (decoder->options.progressiveMode == PROGRESSIVE_EVERY_SCAN) {
+					memset(decoder->dirtyBlocks, 1, decoder->totalBlocks);
+				}
+				renderRows(decoder, &decoder->stats, 0, decoder->components[0].scanBlocksPerColumn);
+				rendered = true;
 			} else {
-				currentBytes[1] = currentBytes[0];
+				rendered = decoder->streaming;
+			}
+			if (rendered) {
+				completeImage(decoder);
+			}
+			continue;
+		}
+		if (status != JPEG_OK) {
+			return status;
+		}
+		decoder->pos = pos + length;
+	}
+	if (!headerOnly) {
+		decoder->segmentsDone = true;
+	}
+	if (!decoder->frameRead || (!headerOnly && decoder->scans == 0)) {
+		return JPEG_ERROR_FORMAT;
+	}
+	if (!headerOnly && !decoder->pulling && !rendered) {
+		if (decoder->info.progressive) {
+			renderRows(decoder, &decoder->stats, 0, decoder->components[0].scanBlocksPerColumn);
+		} else {
+			for (int row = 0; row < decoder->mcusPerColumn; row++) {
+				renderMcuRow(decoder, &decoder->stats, row);
+			}
+		}
+		completeImage(decoder);
+	}
+	return JPEG_OK;
+}
+
+static void closeImage(struct jpegDecoder* decoder) {
+	for (int i = 0; i < 4; i++) {
+		free(decoder->dcTables[i]);
+		free(decoder->acTables[i]);
+		free(decoder->qtables[i]);
+		decoder->dcTables[i] = NULL;
+		decoder->acTables[i] = NULL;
+		decoder->qtables[i] = NULL;
+	}
+	for (int c = 0; c < 3; c++) {
+		freeAligned(decoder->components[c].coefficients);
+		decoder->components[c].coefficients = NULL;
+	}
+	free(decoder->out);
+	free(decoder->rowBuffer);
+	free(decoder->sampleRows);
+	free(decoder->dirtyBlocks);
+	free(decoder->blockExtents);
+	free(decoder->dirtyColumns);
+	decoder->out = NULL;
+	decoder->rowBuffer = NULL;
+	decoder->sampleRows = NULL;
+	free(decoder->band);
+	decoder->band = NULL;
+	decoder->output = NULL;
+	decoder->outputOrigin = 0;
+	decoder->scanActive = false;
+	decoder->scans = 0;
+	decoder->segmentsDone = false;
+	decoder->pulling = false;
+	decoder->bandNext = 0;
+	decoder->bandEnd = 0;
+	decoder->dirtyBlocks = NULL;
+	decoder->blockExtents = NULL;
+	decoder->dirtyColumns = NULL;
+	if (decoder->fileMapped) {
+		unmapFile(&decoder->file);
+		decoder->fileMapped = false;
+	}
+	decoder->data = NULL;
+	decoder->size = 0;
+	decoder->pos = 0;
+	decoder->frameRead = false;
+	decoder->restartInterval = 0;
+	memset(&decoder->stats, 0, sizeof(decoder->stats));
+	decoder->parallelSeconds = 0;
+	decoder->parallelStageSeconds = 0;
+}
+
+void jpegDefaultOptions(struct jpegOptions* options) {
+	options->idctMethod = IDCT_INTEGER;
+	options->upsampleMethod = UPSAMPLE_FANCY;
+	options->pixelFormat = PIXEL_RGB24;
+	options->simdLevel = SIMD_AVX2;
+	options->threads = 1;
+	options->scaleDenominator = 1;
+	options->progressiveMode = PROGRESSIVE_FINAL;
+	options->scanComplete = NULL;
+	options->regionComplete = NULL;
+	options->user = NULL;
+}
+
+struct jpegDecoder* jpegCreate(const struct jpegOptions* options) {
+	struct jpegDecoder* decoder = (struct jpegDecoder*)calloc(1, sizeof(struct jpegDecoder));
+	if (!decoder) {
+		return NULL;
+	}
+	if (options) {
+		decoder->options = *options;
+	} else {
+		jpegDefaultOptions(&decoder->options);
+	}
+	initKernels(&decoder->kernels, decoder->options.simdLevel);
+	decoder->pool = createThreadPool(decoder->options.threads);
+	return decoder;
+}
+
+enum jpegStatus jpegOpenMemory(struct jpegDecoder* decoder, const unsigned char* data, size_t size) {
+	if (!decoder || !data) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	closeImage(decoder);
+	decoder->data = data;
+	decoder->size = size;
+	return JPEG_OK;
+}
+
+enum jpegStatus jpegOpenFile(struct jpegDecoder* decoder, const char* fileName) {
+	if (!decoder || !fileName) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	closeImage(decoder);
+	if (mapFile(fileName, &decoder->file) != 0) {
+		return JPEG_ERROR_OPEN;
+	}
+	decoder->fileMapped = true;
+	decoder->data = decoder->file.data;
+	decoder->size = decoder->file.size;
+	return JPEG_OK;
+}
+
+enum jpegStatus jpegReadHeader(struct jpegDecoder* decoder, struct jpegInfo* info) {
+	int scale = decoder ? decoder->options.scaleDenominator : 0;
+	if (!decoder || !decoder->data || (scale != 1 && scale != 2 && scale != 4 && scale != 8) || decoder->options.pixelFormat > PIXEL_YUV_RAW) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	if (!decoder->frameRead) {
+		double start = currentTime();
+		enum jpegStatus status = processSegments(decoder, true);
+		decoder->stats.totalSeconds += currentTime() - start;
+		if (status != JPEG_OK) {
+			return status;
+		}
+	}
+	if (info) {
+		*info = decoder->info;
+	}
+	return JPEG_OK;
+}
+
+enum jpegStatus jpegSetCrop(struct jpegDecoder* decoder, int x, int y, int width, int height) {
+	enum jpegStatus status = jpegReadHeader(decoder, NULL);
+	if (status != JPEG_OK) {
+		return status;
+	}
+	if (x < 0 || y < 0 || width < 1 || height < 1 || width > decoder->info.width - x || height > decoder->info.height - y || decoder->scans > 0 || decoder->pulling) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	decoder->cropX = x;
+	decoder->cropY = y;
+	decoder->cropWidth = width;
+	decoder->cropHeight = height;
+	return JPEG_OK;
+}
+
+enum jpegStatus jpegGetPlaneSize(struct jpegDecoder* decoder, int component, int* width, int* height) {
+	enum jpegStatus status = jpegReadHeader(decoder, NULL);
+	if (status != JPEG_OK) {
+		return status;
+	}
+	if (component < 0 || component >= decoder->numComponents || !width || !height) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	int ratioH = decoder->components[component].ratioH;
+	int ratioV = decoder->components[component].ratioV;
+	*width = (decoder->cropX + decoder->cropWidth + ratioH - 1) / ratioH - decoder->cropX / ratioH;
+	*height = (decoder->cropY + decoder->cropHeight + ratioV - 1) / ratioV - decoder->cropY / ratioV;
+	return JPEG_OK;
+}
+
+enum jpegStatus jpegDecode(struct jpegDecoder* decoder, unsigned char* output, size_t stride) {
+	enum jpegStatus status = jpegReadHeader(decoder, NULL);
+	if (status != JPEG_OK) {
+		return status;
+	}
+	if (!output || stride < (size_t)decoder->cropWidth * pixelSize(decoder->options.pixelFormat) || decoder->scans > 0 || decoder->pulling) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	decoder->output = output;
+	decoder->stride = stride;
+	decoder->outputOrigin = decoder->cropY;
+	double start = currentTime();
+	status = processSegments(decoder, false);
+	decoder->stats.totalSeconds += currentTime() - start;
+	return status;
+}
+
+static enum jpegStatus produceBand(struct jpegDecoder* decoder) {
+	if (!decoder->scanActive && !decoder->segmentsDone) {
+		enum jpegStatus status = processSegments(decoder, false);
+		if (status != JPEG_OK) {
+			return status;
+		}
+	}
+	struct component* luma = &decoder->components[0];
+	int size = decoder->blockSize;
+	int firstRow = decoder->bandEnd / size / luma->v * luma->v;
+	int lastRow = firstRow + luma->v < luma->scanBlocksPerColumn ? firstRow + luma->v : luma->scanBlocksPerColumn;
+	int cropEnd = decoder->cropY + decoder->cropHeight;
+	decoder->outputOrigin = firstRow * size;
+	if (decoder->scanActive) {
+		continueScan(decoder, firstRow / luma->v + 1 + decoder->contextRows - decoder->nextMcu / decoder->mcusPerLine);
+	}
+	renderRows(decoder, &decoder->stats, firstRow, lastRow);
+	decoder->bandNext = firstRow * size > decoder->cropY ? firstRow * size : decoder->cropY;
+	decoder->bandEnd = lastRow * size < cropEnd ? lastRow * size : cropEnd;
+	return JPEG_OK;
+}
+
+enum jpegStatus jpegReadScanlines(struct jpegDecoder* decoder, unsigned char* rows, size_t stride, int maxRows, int* rowsRead) {
+	enum jpegStatus status = jpegReadHeader(decoder, NULL);
+	if (status != JPEG_OK) {
+		return status;
+	}
+	size_t rowSize = (size_t)decoder->cropWidth * pixelSize(decoder->options.pixelFormat);
+	if (!rows || !rowsRead || decoder->options.pixelFormat >= PIXEL_YUV_PLANAR || maxRows < 0 || stride < rowSize || (decoder->scans > 0 && !decoder->pulling)) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	*rowsRead = 0;
+	if (!decoder->pulling) {
+		decoder->band = malloc(rowSize * decoder->blockSize * decoder->components[0].v);
+		if (!decoder->band) {
+			return JPEG_ERROR_MEMORY;
+		}
+		decoder->pulling = true;
+		decoder->output = decoder->band;
+		decoder->stride = rowSize;
+		decoder->bandNext = decoder->cropY;
+		decoder->bandEnd = decoder->cropY;
+	}
+	double start = currentTime();
+	while (*rowsRead < maxRows && status == JPEG_OK) {
+		if (decoder->bandNext < decoder->bandEnd) {
+			int count = decoder->bandEnd - decoder->bandNext;
+			count = count < maxRows - *rowsRead ? count : maxRows - *rowsRead;
+			for (int i = 0; i < count; i++) {
+				memcpy(rows + (size_t)(*rowsRead + i) * stride, decoder->band + (size_t)(decoder->bandNext - decoder->outputOrigin + i) * rowSize, rowSize);
 			}
+			decoder->bandNext += count;
+			*rowsRead += count;
+		} else if (decoder->bandEnd >= decoder->cropY + decoder->cropHeight) {
+			break;
+		} else {
+			status = produceBand(decoder);
 		}
 	}
-	fflush(stdout);
-	fclose(img_ptr);
-	printf("\nImage rendering complete. Press any key to close.\n");
-	getchar();
-	for (int i = 0; i < 8; i++) {
-		if (dcTrees[i] != NULL) {
-			deleteTree(dcTrees[i]);
+	decoder->stats.totalSeconds += currentTime() - start;
+	return status;
+}
+
+void jpegGetStats(const struct jpegDecoder* decoder, struct jpegStats* stats) {
+	*stats = decoder->stats;
+	double stageSeconds = stats->entropySeconds + stats->idctSeconds + stats->colorSeconds;
+	stats->markerSeconds = stats->totalSeconds - decoder->parallelSeconds - (stageSeconds - decoder->parallelStageSeconds);
+	stats->markerSeconds = stats->markerSeconds > 0 ? stats->markerSeconds : 0;
+	stats->cpuSeconds = stats->markerSeconds + stageSeconds;
+}
+
+static size_t outputSize(struct jpegDecoder* decoder, size_t stride) {
+	enum pixelFormat format = decoder->options.pixelFormat;
+	size_t rows = format == PIXEL_YUV_PLANAR ? (size_t)decoder->cropHeight * 3 : (size_t)decoder->cropHeight;
+	if (format == PIXEL_YUV_RAW) {
+		rows = 0;
+		for (int c = 0; c < decoder->numComponents; c++) {
+			int width, height;
+			jpegGetPlaneSize(decoder, c, &width, &height);
+			rows += height;
 		}
-		if (acTrees[i] != NULL) {
-			deleteTree(acTrees[i]);
+	}
+	return stride * rows;
+}
+
+static void decodeBatchFiles(void* context, int index) {
+	struct batchContext* batch = (struct batchContext*)context;
+	struct batchWorker* worker = &batch->workers[index];
+	for (;;) {
+		mtx_lock(&batch->lock);
+		int file = batch->nextFile++;
+		mtx_unlock(&batch->lock);
+		if (file >= batch->count) {
+			break;
+		}
+		struct jpegDecoder* decoder = worker->decoder;
+		enum jpegStatus status = jpegOpenFile(decoder, batch->fileNames[file]);
+		if (status == JPEG_OK) {
+			status = jpegReadHeader(decoder, NULL);
+		}
+		size_t stride = status == JPEG_OK ? (size_t)decoder->cropWidth * pixelSize(decoder->options.pixelFormat) : 0;
+		size_t size = status == JPEG_OK ? outputSize(decoder, stride) : 0;
+		if (size > worker->capacity) {
+			unsigned char* grown = (unsigned char*)realloc(worker->pixels, size);
+			if (grown) {
+				worker->pixels = grown;
+				worker->capacity = size;
+			} else {
+				status = JPEG_ERROR_MEMORY;
+			}
+		}
+		if (status == JPEG_OK) {
+			status = jpegDecode(decoder, worker->pixels, stride);
 		}
-		if (qtables[i] != NULL) {
-			free(qtables[i]);
+		if (status == JPEG_OK) {
+			worker->stats.images++;
+			worker->stats.bytes += (double)decoder->size;
+			worker->stats.pixels += (double)decoder->cropWidth * decoder->cropHeight;
+		} else {
+			worker->stats.failures++;
+		}
+		if (batch->imageDecoded) {
+			batch->imageDecoded(batch->user, index, file, decoder, status, status == JPEG_OK ? worker->pixels : NULL, stride);
 		}
 	}
-	free(qBlocks);
-	free(out);
-	free(preTransBlocks);
-	free(imgBlocks);
-	SDL_DestroyWindow(window);
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyTexture(texture);
-	SDL_Quit();
-	return 0;
+}
+
+enum jpegStatus jpegDecodeFiles(const struct jpegOptions* options, const char* const* fileNames, int count, void (*imageDecoded)(void* user, int worker, int index, struct jpegDecoder* decoder, enum jpegStatus status, const unsigned char* pixels, size_t stride), void* user, struct jpegBatchStats* stats) {
+	struct jpegOptions workerOptions;
+	if (options) {
+		workerOptions = *options;
+	} else {
+		jpegDefaultOptions(&workerOptions);
+	}
+	if ((count > 0 && !fileNames) || count < 0 || workerOptions.threads < 1) {
+		return JPEG_ERROR_ARGUMENT;
+	}
+	int workers = workerOptions.threads < count ? workerOptions.threads : count;
+	workers = workers > 1 ? workers : 1;
+	workerOptions.threads = 1;
+	struct batchContext batch;
+	memset(&batch, 0, sizeof(batch));
+	batch.fileNames = fileNames;
+	batch.count = count;
+	batch.imageDecoded = imageDecoded;
+	batch.user = user;
+	batch.workers = (struct batchWorker*)calloc(workers, sizeof(struct batchWorker));
+	if (!batch.workers || mtx_init(&batch.lock, mtx_plain) != thrd_success) {
+		free(batch.workers);
+		return JPEG_ERROR_MEMORY;
+	}
+	enum jpegStatus status = JPEG_OK;
+	for (int i = 0; i < workers && status == JPEG_OK; i++) {
+		batch.workers[i].decoder = jpegCreate(&workerOptions);
+		if (!batch.workers[i].decoder) {
+			status = JPEG_ERROR_MEMORY;
+		}
+	}
+	struct threadPool* pool = status == JPEG_OK ? createThreadPool(workers) : NULL;
+	double start = currentTime();
+	if (status == JPEG_OK) {
+		runTasks(pool, workers, decodeBatchFiles, &batch);
+	}
+	double seconds = currentTime() - start;
+	destroyThreadPool(pool);
+	struct jpegBatchStats totals;
+	memset(&totals, 0, sizeof(totals));
+	totals.seconds = seconds;
+	for (int i = 0; i < workers; i++) {
+		totals.images += batch.workers[i].stats.images;
+		totals.failures += batch.workers[i].stats.failures;
+		totals.bytes += batch.workers[i].stats.bytes;
+		totals.pixels += batch.workers[i].stats.pixels;
+		jpegDestroy(batch.workers[i].decoder);
+		free(batch.workers[i].pixels);
+	}
+	mtx_destroy(&batch.lock);
+	free(batch.workers);
+	if (stats) {
+		*stats = totals;
+	}
+	return status;
+}
+
+void jpegDestroy(struct jpegDecoder* decoder) {
+	if (!decoder) {
+		return;
+	}
+	closeImage(decoder);
+	destroyThreadPool(decoder->pool);
+	free(decoder);
+}
+
+const char* jpegStatusString(enum jpegStatus status) {
+	switch (status) {
+	case JPEG_OK:
+		return "ok";
+	case JPEG_ERROR_OPEN:
+		return "could not open file";
+	case JPEG_ERROR_MEMORY:
+		return "allocation failed";
+	case JPEG_ERROR_FORMAT:
+		return "malformed jpeg data";
+	case JPEG_ERROR_UNSUPPORTED:
+		return "unsupported jpeg feature";
+	case JPEG_ERROR_ARGUMENT:
+		return "invalid argument";
+	}
+	return "unknown error";
 }
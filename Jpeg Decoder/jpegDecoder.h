@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+enum jpegStatus {
+	JPEG_OK,
+	JPEG_ERROR_OPEN,
+	JPEG_ERROR_MEMORY,
+	JPEG_ERROR_FORMAT,
+	JPEG_ERROR_UNSUPPORTED,
+	JPEG_ERROR_ARGUMENT
+};
+
+enum idctMethod {
+	IDCT_INTEGER,
+	IDCT_FLOAT,
+	IDCT_REFERENCE
+};
+
+enum upsampleMethod {
+	UPSAMPLE_FANCY,
+	UPSAMPLE_REPLICATE
+};
+
+enum pixelFormat {
+	PIXEL_RGB24,
+	PIXEL_RGBA32,
+	PIXEL_BGRA32,
+	PIXEL_GRAY8,
+	PIXEL_YUV_PLANAR,
+	PIXEL_YUV_RAW
+};
+
+enum simdLevel {
+	SIMD_NONE,
+	SIMD_SSE2,
+	SIMD_AVX2
+};
+
+enum progressiveMode {
+	PROGRESSIVE_FINAL,
+	PROGRESSIVE_EVERY_SCAN,
+	PROGRESSIVE_INCREMENTAL
+};
+
+struct jpegInfo {
+	int width;
+	int height;
+	int imageWidth;
+	int imageHeight;
+	int components;
+	bool progressive;
+};
+
+struct jpegStats {
+	double totalSeconds;
+	double cpuSeconds;
+	double markerSeconds;
+	double entropySeconds;
+	double idctSeconds;
+	double colorSeconds;
+};
+
+struct jpegBatchStats {
+	int images;
+	int failures;
+	double seconds;
+	double bytes;
+	double pixels;
+};
+
+struct jpegOptions {
+	enum idctMethod idctMethod;
+	enum upsampleMethod upsampleMethod;
+	enum pixelFormat pixelFormat;
+	enum simdLevel simdLevel;
+	int threads;
+	int scaleDenominator;
+	enum progressiveMode progressiveMode;
+	void (*scanComplete)(void* user, const unsigned char* pixels, int width, int height, size_t stride);
+	void (*regionComplete)(void* user, const unsigned char* pixels, size_t stride, int x, int y, int width, int height);
+	void* user;
+};
+
+struct jpegDecoder;
+
+void jpegDefaultOptions(struct jpegOptions* options);
+struct jpegDecoder* jpegCreate(const struct jpegOptions* options);
+enum jpegStatus jpegOpenMemory(struct jpegDecoder* decoder, const unsigned char* data, size_t size);
+enum jpegStatus jpegOpenFile(struct jpegDecoder* decoder, const char* fileName);
+enum jpegStatus jpegReadHeader(struct jpegDecoder* decoder, struct jpegInfo* info);
+enum jpegStatus jpegSetCrop(struct jpegDecoder* decoder, int x, int y, int width, int height);
+enum jpegStatus jpegGetPlaneSize(struct jpegDecoder* decoder, int component, int* width, int* height);
+enum jpegStatus jpegDecode(struct jpegDecoder* decoder, unsigned char* output, size_t stride);
+enum jpegStatus jpegReadScanlines(struct jpegDecoder* decoder, unsigned char* rows, size_t stride, int maxRows, int* rowsRead);
+void jpegGetStats(const struct jpegDecoder* decoder, struct jpegStats* stats);
+enum jpegStatus jpegDecodeFiles(const struct jpegOptions* options, const char* const* fileNames, int count, void (*imageDecoded)(void* user, int worker, int index, struct jpegDecoder* decoder, enum jpegStatus status, const unsigned char* pixels, size_t stride), void* user, struct jpegBatchStats* stats);
+void jpegDestroy(struct jpegDecoder* decoder);
+const char* jpegStatusString(enum jpegStatus status);
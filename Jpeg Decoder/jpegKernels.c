@@ -0,0 +1,560 @@
+#include <stdbool.h>
+#include <math.h>
+#include <threads.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+#include "jpegKernels.h"
+
+const unsigned char zigzag[64] = {
+	0, 1, 5, 6, 14, 15, 27, 28,
+	2, 4, 7, 13, 16, 26, 29, 42,
+	3, 8, 12, 17, 25, 30, 41, 43,
+	9, 11, 18, 24, 31, 40, 44, 53,
+	10, 19, 23, 32, 39, 45, 52, 54,
+	20, 22, 33, 38, 46, 51, 55, 60,
+	21, 34, 37, 47, 50, 56, 59, 61,
+	35, 36, 48, 49, 57, 58, 62, 63
+};
+
+const unsigned char naturalOrder[64] = {
+	0, 1, 8, 16, 9, 2, 3, 10,
+	17, 24, 32, 25, 18, 11, 4, 5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63
+};
+
+float aanScale[64];
+
+static int redCrTable[256];
+static int greenCbTable[256];
+static int greenCrTable[256];
+static int blueCbTable[256];
+static unsigned char rangeLimit[768];
+static once_flag tablesOnce = ONCE_FLAG_INIT;
+
+static int clampInt16(int value) {
+	return value < -32768 ? -32768 : value > 32767 ? 32767 : value;
+}
+
+static short clampSample(int value) {
+	return (short)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+static short roundSample(float value) {
+	value = value < -256.0f ? -256.0f : value > 256.0f ? 256.0f : value;
+	return clampSample((int)roundf(value) + 128);
+}
+
+void idct1dInteger(int* data, int stride, int shift) {
+	int in0 = data[0], in1 = data[stride], in2 = data[2 * stride], in3 = data[3 * stride];
+	int in4 = data[4 * stride], in5 = data[5 * stride], in6 = data[6 * stride], in7 = data[7 * stride];
+	int z1 = (in2 + in6) * 4433;
+	int tmp2 = z1 - in6 * 15137;
+	int tmp3 = z1 + in2 * 6270;
+	int tmp0 = (in0 + in4) * (1 << IDCT_CONST_BITS);
+	int tmp1 = (in0 - in4) * (1 << IDCT_CONST_BITS);
+	int tmp10 = tmp0 + tmp3;
+	int tmp13 = tmp0 - tmp3;
+	int tmp11 = tmp1 + tmp2;
+	int tmp12 = tmp1 - tmp2;
+	z1 = in7 + in1;
+	int z2 = in5 + in3;
+	int z3 = in7 + in3;
+	int z4 = in5 + in1;
+	int z5 = (z3 + z4) * 9633;
+	z1 *= -7373;
+	z2 *= -20995;
+	z3 = z3 * -16069 + z5;
+	z4 = z4 * -3196 + z5;
+	tmp0 = in7 * 2446 + z1 + z3;
+	tmp1 = in5 * 16819 + z2 + z4;
+	tmp2 = in3 * 25172 + z2 + z3;
+	tmp3 = in1 * 12299 + z1 + z4;
+	data[0] = IDCT_DESCALE(tmp10 + tmp3, shift);
+	data[7 * stride] = IDCT_DESCALE(tmp10 - tmp3, shift);
+	data[stride] = IDCT_DESCALE(tmp11 + tmp2, shift);
+	data[6 * stride] = IDCT_DESCALE(tmp11 - tmp2, shift);
+	data[2 * stride] = IDCT_DESCALE(tmp12 + tmp1, shift);
+	data[5 * stride] = IDCT_DESCALE(tmp12 - tmp1, shift);
+	data[3 * stride] = IDCT_DESCALE(tmp13 + tmp0, shift);
+	data[4 * stride] = IDCT_DESCALE(tmp13 - tmp0, shift);
+}
+
+void idct1dInteger4(int* data, int stride, int shift) {
+	int in0 = data[0], in1 = data[stride], in2 = data[2 * stride], in3 = data[3 * stride];
+	int z1 = in2 * 4433;
+	int tmp2 = z1;
+	int tmp3 = z1 + in2 * 6270;
+	int tmp0 = in0 * (1 << IDCT_CONST_BITS);
+	int tmp10 = tmp0 + tmp3;
+	int tmp13 = tmp0 - tmp3;
+	int tmp11 = tmp0 + tmp2;
+	int tmp12 = tmp0 - tmp2;
+	int z5 = (in3 + in1) * 9633;
+	z1 = in1 * -7373;
+	int z2 = in3 * -20995;
+	int z3 = in3 * -16069 + z5;
+	int z4 = in1 * -3196 + z5;
+	tmp0 = z1 + z3;
+	int tmp1 = z2 + z4;
+	tmp2 = in3 * 25172 + z2 + z3;
+	tmp3 = in1 * 12299 + z1 + z4;
+	data[0] = IDCT_DESCALE(tmp10 + tmp3, shift);
+	data[7 * stride] = IDCT_DESCALE(tmp10 - tmp3, shift);
+	data[stride] = IDCT_DESCALE(tmp11 + tmp2, shift);
+	data[6 * stride] = IDCT_DESCALE(tmp11 - tmp2, shift);
+	data[2 * stride] = IDCT_DESCALE(tmp12 + tmp1, shift);
+	data[5 * stride] = IDCT_DESCALE(tmp12 - tmp1, shift);
+	data[3 * stride] = IDCT_DESCALE(tmp13 + tmp0, shift);
+	data[4 * stride] = IDCT_DESCALE(tmp13 - tmp0, shift);
+}
+
+void idct1dInteger2(int* data, int stride, int shift) {
+	int in0 = data[0], in1 = data[stride];
+	int tmp10 = in0 * (1 << IDCT_CONST_BITS);
+	int z5 = in1 * 9633;
+	int z1 = in1 * -7373;
+	int z4 = in1 * -3196 + z5;
+	int tmp0 = z1 + z5;
+	int tmp1 = z4;
+	int tmp2 = z5;
+	int tmp3 = in1 * 12299 + z1 + z4;
+	data[0] = IDCT_DESCALE(tmp10 + tmp3, shift);
+	data[7 * stride] = IDCT_DESCALE(tmp10 - tmp3, shift);
+	data[stride] = IDCT_DESCALE(tmp10 + tmp2, shift);
+	data[6 * stride] = IDCT_DESCALE(tmp10 - tmp2, shift);
+	data[2 * stride] = IDCT_DESCALE(tmp10 + tmp1, shift);
+	data[5 * stride] = IDCT_DESCALE(tmp10 - tmp1, shift);
+	data[3 * stride] = IDCT_DESCALE(tmp10 + tmp0, shift);
+	data[4 * stride] = IDCT_DESCALE(tmp10 - tmp0, shift);
+}
+
+static void idctIntegerSparse(const short* coefficients, const int* quant, short output[8][8], int size) {
+	void (*idct1d)(int* data, int stride, int shift) = size == 2 ? idct1dInteger2 : idct1dInteger4;
+	int workspace[64];
+	for (int col = 0; col < size; col++) {
+		for (int row = 0; row < size; row++) {
+			workspace[row * 8 + col] = clampInt16(coefficients[row * 8 + col] * quant[row * 8 + col]);
+		}
+		idct1d(workspace + col, 8, IDCT_CONST_BITS - IDCT_PASS1_BITS);
+	}
+	for (int row = 0; row < 8; row++) {
+		for (int col = 0; col < size; col++) {
+			workspace[row * 8 + col] = clampInt16(workspace[row * 8 + col]);
+		}
+		idct1d(workspace + row * 8, 1, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+		for (int col = 0; col < 8; col++) {
+			output[row][col] = clampSample(workspace[row * 8 + col] + 128);
+		}
+	}
+}
+
+void idctIntegerDc(const short* coefficients, const int* quant, short output[8][8]) {
+	short value = clampSample(IDCT_DESCALE(clampInt16(coefficients[0] * quant[0]), 3) + 128);
+	short* pixels = &output[0][0];
+	for (int i = 0; i < 64; i++) {
+		pixels[i] = value;
+	}
+}
+
+void idctInteger2x2Scalar(const short* coefficients, const int* quant, short output[8][8]) {
+	idctIntegerSparse(coefficients, quant, output, 2);
+}
+
+void idctInteger4x4Scalar(const short* coefficients, const int* quant, short output[8][8]) {
+	idctIntegerSparse(coefficients, quant, output, 4);
+}
+
+void idctIntegerScalar(const short* coefficients, const int* quant, short output[8][8]) {
+	int workspace[64];
+	for (int col = 0; col < 8; col++) {
+		bool acZero = true;
+		for (int row = 0; row < 8; row++) {
+			workspace[row * 8 + col] = clampInt16(coefficients[row * 8 + col] * quant[row * 8 + col]);
+			if (row > 0 && workspace[row * 8 + col] != 0) {
+				acZero = false;
+			}
+		}
+		if (acZero) {
+			int dc = workspace[col] * (1 << IDCT_PASS1_BITS);
+			for (int row = 0; row < 8; row++) {
+				workspace[row * 8 + col] = dc;
+			}
+		} else {
+			idct1dInteger(workspace + col, 8, IDCT_CONST_BITS - IDCT_PASS1_BITS);
+		}
+	}
+	for (int i = 0; i < 64; i++) {
+		workspace[i] = clampInt16(workspace[i]);
+	}
+	for (int row = 0; row < 8; row++) {
+		idct1dInteger(workspace + row * 8, 1, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+		for (int col = 0; col < 8; col++) {
+			output[row][col] = clampSample(workspace[row * 8 + col] + 128);
+		}
+	}
+}
+
+void idctScaled4x4(const short* coefficients, const int* quant, short output[8][8]) {
+	int workspace[16];
+	for (int col = 0; col < 4; col++) {
+		int in0 = clampInt16(coefficients[col] * quant[col]);
+		int in1 = clampInt16(coefficients[8 + col] * quant[8 + col]);
+		int in2 = clampInt16(coefficients[16 + col] * quant[16 + col]);
+		int in3 = clampInt16(coefficients[24 + col] * quant[24 + col]);
+		int tmp10 = (in0 + in2) * (1 << IDCT_PASS1_BITS);
+		int tmp12 = (in0 - in2) * (1 << IDCT_PASS1_BITS);
+		int z1 = (in1 + in3) * 4433 + (1 << (IDCT_CONST_BITS - IDCT_PASS1_BITS - 1));
+		int tmp0 = (z1 + in1 * 6270) >> (IDCT_CONST_BITS - IDCT_PASS1_BITS);
+		int tmp2 = (z1 - in3 * 15137) >> (IDCT_CONST_BITS - IDCT_PASS1_BITS);
+		workspace[col] = clampInt16(tmp10 + tmp0);
+		workspace[12 + col] = clampInt16(tmp10 - tmp0);
+		workspace[4 + col] = clampInt16(tmp12 + tmp2);
+		workspace[8 + col] = clampInt16(tmp12 - tmp2);
+	}
+	for (int row = 0; row < 4; row++) {
+		const int* in = workspace + row * 4;
+		int tmp0 = in[0] + (1 << (IDCT_PASS1_BITS + 2));
+		int tmp10 = (tmp0 + in[2]) * (1 << IDCT_CONST_BITS);
+		int tmp12 = (tmp0 - in[2]) * (1 << IDCT_CONST_BITS);
+		int z1 = (in[1] + in[3]) * 4433;
+		tmp0 = z1 + in[1] * 6270;
+		int tmp2 = z1 - in[3] * 15137;
+		output[row][0] = clampSample(((tmp10 + tmp0) >> (IDCT_CONST_BITS + IDCT_PASS1_BITS + 3)) + 128);
+		output[row][3] = clampSample(((tmp10 - tmp0) >> (IDCT_CONST_BITS + IDCT_PASS1_BITS + 3)) + 128);
+		output[row][1] = clampSample(((tmp12 + tmp2) >> (IDCT_CONST_BITS + IDCT_PASS1_BITS + 3)) + 128);
+		output[row][2] = clampSample(((tmp12 - tmp2) >> (IDCT_CONST_BITS + IDCT_PASS1_BITS + 3)) + 128);
+	}
+}
+
+void idctScaled2x2(const short* coefficients, const int* quant, short output[8][8]) {
+	int tmp4 = clampInt16(coefficients[0] * quant[0]) + 4;
+	int tmp5 = clampInt16(coefficients[8] * quant[8]);
+	int tmp0 = tmp4 + tmp5;
+	int tmp2 = tmp4 - tmp5;
+	tmp4 = clampInt16(coefficients[1] * quant[1]);
+	tmp5 = clampInt16(coefficients[9] * quant[9]);
+	int tmp1 = tmp4 + tmp5;
+	int tmp3 = tmp4 - tmp5;
+	output[0][0] = clampSample(((tmp0 + tmp1) >> 3) + 128);
+	output[0][1] = clampSample(((tmp0 - tmp1) >> 3) + 128);
+	output[1][0] = clampSample(((tmp2 + tmp3) >> 3) + 128);
+	output[1][1] = clampSample(((tmp2 - tmp3) >> 3) + 128);
+}
+
+void idctScaled1x1(const short* coefficients, const int* quant, short output[8][8]) {
+	output[0][0] = clampSample(IDCT_DESCALE(clampInt16(coefficients[0] * quant[0]), 3) + 128);
+}
+
+void idctReference(const short* coefficients, const int* quant, int size, short output[8][8]) {
+	const double pi = 3.14159265358979323846;
+	double basis[8][8];
+	for (int x = 0; x < size; x++) {
+		for (int u = 0; u < size; u++) {
+			basis[x][u] = (u == 0 ? sqrt(0.5) : 1.0) * cos((2.0 * x + 1.0) * u * pi / (2.0 * size));
+		}
+	}
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			double sum = 0.0;
+			for (int v = 0; v < size; v++) {
+				for (int u = 0; u < size; u++) {
+					sum += basis[y][v] * basis[x][u] * coefficients[v * 8 + u] * quant[v * 8 + u];
+				}
+			}
+			float value = (float)(sum / 4.0 + 128.0);
+			value = value < 0.0f ? 0.0f : value > 255.0f ? 255.0f : value;
+			output[y][x] = (short)(value + 0.5f);
+		}
+	}
+}
+
+void idct1dFloat(float* data, int stride) {
+	float in0 = data[0], in1 = data[stride], in2 = data[2 * stride], in3 = data[3 * stride];
+	float in4 = data[4 * stride], in5 = data[5 * stride], in6 = data[6 * stride], in7 = data[7 * stride];
+	float tmp10 = in0 + in4;
+	float tmp11 = in0 - in4;
+	float tmp13 = in2 + in6;
+	float tmp12 = (in2 - in6) * 1.414213562f - tmp13;
+	float tmp0 = tmp10 + tmp13;
+	float tmp3 = tmp10 - tmp13;
+	float tmp1 = tmp11 + tmp12;
+	float tmp2 = tmp11 - tmp12;
+	float z13 = in5 + in3;
+	float z10 = in5 - in3;
+	float z11 = in1 + in7;
+	float z12 = in1 - in7;
+	float tmp7 = z11 + z13;
+	tmp11 = (z11 - z13) * 1.414213562f;
+	float z5 = (z10 + z12) * 1.847759065f;
+	tmp10 = 1.082392200f * z12 - z5;
+	tmp12 = -2.613125930f * z10 + z5;
+	float tmp6 = tmp12 - tmp7;
+	float tmp5 = tmp11 - tmp6;
+	float tmp4 = tmp10 + tmp5;
+	data[0] = tmp0 + tmp7;
+	data[7 * stride] = tmp0 - tmp7;
+	data[stride] = tmp1 + tmp6;
+	data[6 * stride] = tmp1 - tmp6;
+	data[2 * stride] = tmp2 + tmp5;
+	data[5 * stride] = tmp2 - tmp5;
+	data[4 * stride] = tmp3 + tmp4;
+	data[3 * stride] = tmp3 - tmp4;
+}
+
+void idct1dFloat4(float* data, int stride) {
+	float in0 = data[0], in1 = data[stride], in2 = data[2 * stride], in3 = data[3 * stride];
+	float tmp12 = in2 * 1.414213562f - in2;
+	float tmp0 = in0 + in2;
+	float tmp3 = in0 - in2;
+	float tmp1 = in0 + tmp12;
+	float tmp2 = in0 - tmp12;
+	float tmp7 = in1 + in3;
+	float tmp11 = (in1 - in3) * 1.414213562f;
+	float z5 = (in1 - in3) * 1.847759065f;
+	float tmp10 = 1.082392200f * in1 - z5;
+	tmp12 = 2.613125930f * in3 + z5;
+	float tmp6 = tmp12 - tmp7;
+	float tmp5 = tmp11 - tmp6;
+	float tmp4 = tmp10 + tmp5;
+	data[0] = tmp0 + tmp7;
+	data[7 * stride] = tmp0 - tmp7;
+	data[stride] = tmp1 + tmp6;
+	data[6 * stride] = tmp1 - tmp6;
+	data[2 * stride] = tmp2 + tmp5;
+	data[5 * stride] = tmp2 - tmp5;
+	data[4 * stride] = tmp3 + tmp4;
+	data[3 * stride] = tmp3 - tmp4;
+}
+
+void idct1dFloat2(float* data, int stride) {
+	float in0 = data[0], in1 = data[stride];
+	float z5 = in1 * 1.847759065f;
+	float tmp6 = z5 - in1;
+	float tmp5 = in1 * 1.414213562f - tmp6;
+	float tmp4 = 1.082392200f * in1 - z5 + tmp5;
+	data[0] = in0 + in1;
+	data[7 * stride] = in0 - in1;
+	data[stride] = in0 + tmp6;
+	data[6 * stride] = in0 - tmp6;
+	data[2 * stride] = in0 + tmp5;
+	data[5 * stride] = in0 - tmp5;
+	data[4 * stride] = in0 + tmp4;
+	data[3 * stride] = in0 - tmp4;
+}
+
+static void idctFloatSparse(const short* coefficients, const float* quant, short output[8][8], int size) {
+	void (*idct1d)(float* data, int stride) = size == 2 ? idct1dFloat2 : idct1dFloat4;
+	float workspace[64];
+	for (int col = 0; col < size; col++) {
+		for (int row = 0; row < size; row++) {
+			workspace[row * 8 + col] = coefficients[row * 8 + col] * quant[row * 8 + col];
+		}
+		idct1d(workspace + col, 8);
+	}
+	for (int row = 0; row < 8; row++) {
+		idct1d(workspace + row * 8, 1);
+		for (int col = 0; col < 8; col++) {
+			output[row][col] = roundSample(workspace[row * 8 + col]);
+		}
+	}
+}
+
+void idctFloatDc(const short* coefficients, const float* quant, short output[8][8]) {
+	short value = roundSample(coefficients[0] * quant[0]);
+	short* pixels = &output[0][0];
+	for (int i = 0; i < 64; i++) {
+		pixels[i] = value;
+	}
+}
+
+void idctFloat2x2Scalar(const short* coefficients, const float* quant, short output[8][8]) {
+	idctFloatSparse(coefficients, quant, output, 2);
+}
+
+void idctFloat4x4Scalar(const short* coefficients, const float* quant, short output[8][8]) {
+	idctFloatSparse(coefficients, quant, output, 4);
+}
+
+void idctFloatScalar(const short* coefficients, const float* quant, short output[8][8]) {
+	float workspace[64];
+	for (int i = 0; i < 64; i++) {
+		workspace[i] = coefficients[i] * quant[i];
+	}
+	for (int col = 0; col < 8; col++) {
+		idct1dFloat(workspace + col, 8);
+	}
+	for (int row = 0; row < 8; row++) {
+		idct1dFloat(workspace + row * 8, 1);
+		for (int col = 0; col < 8; col++) {
+			output[row][col] = roundSample(workspace[row * 8 + col]);
+		}
+	}
+}
+
+void fancyUpsampleV2Scalar(const short* near, const short* far, short* output, int count, int shift) {
+	int round = (1 << shift) >> 1;
+	for (int i = 0; i < count; i++) {
+		output[i] = (short)((3 * near[i] + far[i] + round) >> shift);
+	}
+}
+
+void fancyUpsampleH2Scalar(const short* samples, short* output, int count, int shift) {
+	int round = (1 << shift) >> 1;
+	for (int i = 0; i < count; i++) {
+		int center = 3 * samples[i] + round;
+		output[i * 2] = (short)((center + samples[i - 1]) >> shift);
+		output[i * 2 + 1] = (short)((center + samples[i + 1]) >> shift);
+	}
+}
+
+void replicateH2Scalar(const short* samples, short* output, int count) {
+	for (int i = 0; i < count; i++) {
+		output[i * 2] = samples[i];
+		output[i * 2 + 1] = samples[i];
+	}
+}
+
+void colorConvertScalar(const short* y, const short* cb, const short* cr, unsigned char* output, int count, enum pixelFormat format) {
+	const unsigned char* limit = rangeLimit + 256;
+	int pixelSize = format == PIXEL_RGB24 ? 3 : 4;
+	int red = format == PIXEL_BGRA32 ? 2 : 0;
+	for (int i = 0; i < count; i++, output += pixelSize) {
+		int Y = y[i];
+		int Cb = cb[i];
+		int Cr = cr[i];
+		output[red] = limit[Y + redCrTable[Cr]];
+		output[1] = limit[Y + ((greenCbTable[Cb] + greenCrTable[Cr]) >> COLOR_SCALE_BITS)];
+		output[2 - red] = limit[Y + blueCbTable[Cb]];
+		if (pixelSize == 4) {
+			output[3] = 255;
+		}
+	}
+}
+
+void storeSamplesScalar(const short* samples, unsigned char* output, int count) {
+	for (int i = 0; i < count; i++) {
+		output[i] = (unsigned char)samples[i];
+	}
+}
+
+void expandGrayScalar(const short* y, unsigned char* output, int count, enum pixelFormat format) {
+	int pixelSize = format == PIXEL_RGB24 ? 3 : 4;
+	for (int i = 0; i < count; i++, output += pixelSize) {
+		unsigned char gray = (unsigned char)y[i];
+		output[0] = gray;
+		output[1] = gray;
+		output[2] = gray;
+		if (pixelSize == 4) {
+			output[3] = 255;
+		}
+	}
+}
+
+enum simdLevel detectSimdLevel(void) {
+#if defined(JPEG_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	if (!(info[3] & (1 << 26))) {
+		return SIMD_NONE;
+	}
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5)) {
+			return SIMD_AVX2;
+		}
+	}
+	return SIMD_SSE2;
+#elif defined(JPEG_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return SIMD_SSE2;
+	}
+	return SIMD_NONE;
+#else
+	return SIMD_NONE;
+#endif
+}
+
+static void initTables(void) {
+	const float aanScaleFactors[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+	for (int row = 0; row < 8; row++) {
+		for (int col = 0; col < 8; col++) {
+			aanScale[row * 8 + col] = aanScaleFactors[row] * aanScaleFactors[col] * 0.125f;
+		}
+	}
+	const int half = 1 << (COLOR_SCALE_BITS - 1);
+	for (int i = 0; i < 256; i++) {
+		int chroma = i - 128;
+		redCrTable[i] = (chroma * COLOR_RED_CR + half) >> COLOR_SCALE_BITS;
+		greenCbTable[i] = chroma * COLOR_GREEN_CB;
+		greenCrTable[i] = chroma * COLOR_GREEN_CR + half;
+		blueCbTable[i] = (chroma * COLOR_BLUE_CB + half) >> COLOR_SCALE_BITS;
+	}
+	for (int i = 0; i < 768; i++) {
+		rangeLimit[i] = (unsigned char)(i < 256 ? 0 : i > 511 ? 255 : i - 256);
+	}
+}
+
+void initKernels(struct kernels* kernels, enum simdLevel level) {
+	call_once(&tablesOnce, initTables);
+	kernels->level = SIMD_NONE;
+	kernels->idctInteger = idctIntegerScalar;
+	kernels->idctInteger4x4 = idctInteger4x4Scalar;
+	kernels->idctInteger2x2 = idctInteger2x2Scalar;
+	kernels->idctFloat = idctFloatScalar;
+	kernels->idctFloat4x4 = idctFloat4x4Scalar;
+	kernels->idctFloat2x2 = idctFloat2x2Scalar;
+	kernels->fancyUpsampleV2 = fancyUpsampleV2Scalar;
+	kernels->fancyUpsampleH2 = fancyUpsampleH2Scalar;
+	kernels->replicateH2 = replicateH2Scalar;
+	kernels->colorConvert = colorConvertScalar;
+	kernels->storeSamples = storeSamplesScalar;
+	kernels->expandGray = expandGrayScalar;
+#ifdef JPEG_X86
+	enum simdLevel supported = detectSimdLevel();
+	if (level > supported) {
+		level = supported;
+	}
+	if (level >= SIMD_SSE2) {
+		kernels->level = SIMD_SSE2;
+		kernels->idctInteger = idctIntegerSse2;
+		kernels->idctInteger4x4 = idctInteger4x4Sse2;
+		kernels->idctInteger2x2 = idctInteger4x4Sse2;
+		kernels->idctFloat = idctFloatSse2;
+		kernels->idctFloat4x4 = idctFloat4x4Sse2;
+		kernels->idctFloat2x2 = idctFloat4x4Sse2;
+		kernels->fancyUpsampleV2 = fancyUpsampleV2Sse2;
+		kernels->fancyUpsampleH2 = fancyUpsampleH2Sse2;
+		kernels->replicateH2 = replicateH2Sse2;
+		kernels->colorConvert = colorConvertSse2;
+		kernels->storeSamples = storeSamplesSse2;
+		kernels->expandGray = expandGraySse2;
+	}
+	if (level >= SIMD_AVX2) {
+		kernels->level = SIMD_AVX2;
+		kernels->idctInteger = idctIntegerAvx2;
+		kernels->idctInteger4x4 = idctInteger4x4Avx2;
+		kernels->idctInteger2x2 = idctInteger4x4Avx2;
+		kernels->idctFloat = idctFloatAvx2;
+		kernels->idctFloat4x4 = idctFloat4x4Avx2;
+		kernels->idctFloat2x2 = idctFloat4x4Avx2;
+		kernels->fancyUpsampleV2 = fancyUpsampleV2Avx2;
+		kernels->fancyUpsampleH2 = fancyUpsampleH2Avx2;
+		kernels->replicateH2 = replicateH2Avx2;
+		kernels->colorConvert = colorConvertAvx2;
+		kernels->storeSamples = storeSamplesAvx2;
+		kernels->expandGray = expandGrayAvx2;
+	}
+#endif
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "jpegDecoder.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define JPEG_X86 1
+#endif
+
+#define IDCT_CONST_BITS 13
+#define IDCT_PASS1_BITS 2
+#define IDCT_DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+#define COLOR_SCALE_BITS 14
+#define COLOR_RED_CR 22970
+#define COLOR_GREEN_CB (-5638)
+#define COLOR_GREEN_CR (-11700)
+#define COLOR_BLUE_CB 29032
+
+#define IDCT_EXTENT_2X2 2
+#define IDCT_EXTENT_4X4 9
+
+struct kernels {
+	enum simdLevel level;
+	void (*idctInteger)(const short* coefficients, const int* quant, short output[8][8]);
+	void (*idctInteger4x4)(const short* coefficients, const int* quant, short output[8][8]);
+	void (*idctInteger2x2)(const short* coefficients, const int* quant, short output[8][8]);
+	void (*idctFloat)(const short* coefficients, const float* quant, short output[8][8]);
+	void (*idctFloat4x4)(const short* coefficients, const float* quant, short output[8][8]);
+	void (*idctFloat2x2)(const short* coefficients, const float* quant, short output[8][8]);
+	void (*fancyUpsampleV2)(const short* near, const short* far, short* output, int count, int shift);
+	void (*fancyUpsampleH2)(const short* samples, short* output, int count, int shift);
+	void (*replicateH2)(const short* samples, short* output, int count);
+	void (*colorConvert)(const short* y, const short* cb, const short* cr, unsigned char* output, int count, enum pixelFormat format);
+	void (*storeSamples)(const short* samples, unsigned char* output, int count);
+	void (*expandGray)(const short* y, unsigned char* output, int count, enum pixelFormat format);
+};
+
+extern const unsigned char zigzag[64];
+extern const unsigned char naturalOrder[64];
+extern float aanScale[64];
+
+enum simdLevel detectSimdLevel(void);
+void initKernels(struct kernels* kernels, enum simdLevel level);
+
+void idctIntegerDc(const short* coefficients, const int* quant, short output[8][8]);
+void idctIntegerScalar(const short* coefficients, const int* quant, short output[8][8]);
+void idctInteger4x4Scalar(const short* coefficients, const int* quant, short output[8][8]);
+void idctInteger2x2Scalar(const short* coefficients, const int* quant, short output[8][8]);
+void idctScaled4x4(const short* coefficients, const int* quant, short output[8][8]);
+void idctScaled2x2(const short* coefficients, const int* quant, short output[8][8]);
+void idctScaled1x1(const short* coefficients, const int* quant, short output[8][8]);
+void idctReference(const short* coefficients, const int* quant, int size, short output[8][8]);
+void idctFloatDc(const short* coefficients, const float* quant, short output[8][8]);
+void idctFloatScalar(const short* coefficients, const float* quant, short output[8][8]);
+void idctFloat4x4Scalar(const short* coefficients, const float* quant, short output[8][8]);
+void idctFloat2x2Scalar(const short* coefficients, const float* quant, short output[8][8]);
+void fancyUpsampleV2Scalar(const short* near, const short* far, short* output, int count, int shift);
+void fancyUpsampleH2Scalar(const short* samples, short* output, int count, int shift);
+void replicateH2Scalar(const short* samples, short* output, int count);
+void colorConvertScalar(const short* y, const short* cb, const short* cr, unsigned char* output, int count, enum pixelFormat format);
+void storeSamplesScalar(const short* samples, unsigned char* output, int count);
+void expandGrayScalar(const short* y, unsigned char* output, int count, enum pixelFormat format);
+
+#ifdef JPEG_X86
+void idctIntegerSse2(const short* coefficients, const int* quant, short output[8][8]);
+void idctInteger4x4Sse2(const short* coefficients, const int* quant, short output[8][8]);
+void idctFloatSse2(const short* coefficients, const float* quant, short output[8][8]);
+void idctFloat4x4Sse2(const short* coefficients, const float* quant, short output[8][8]);
+void fancyUpsampleV2Sse2(const short* near, const short* far, short* output, int count, int shift);
+void fancyUpsampleH2Sse2(const short* samples, short* output, int count, int shift);
+void replicateH2Sse2(const short* samples, short* output, int count);
+void colorConvertSse2(const short* y, const short* cb, const short* cr, unsigned char* output, int count, enum pixelFormat format);
+void storeSamplesSse2(const short* samples, unsigned char* output, int count);
+void expandGraySse2(const short* y, unsigned char* output, int count, enum pixelFormat format);
+void idctIntegerAvx2(const short* coefficients, const int* quant, short output[8][8]);
+void idctInteger4x4Avx2(const short* coefficients, const int* quant, short output[8][8]);
+void idctFloatAvx2(const short* coefficients, const float* quant, short output[8][8]);
+void idctFloat4x4Avx2(const short* coefficients, const float* quant, short output[8][8]);
+void fancyUpsampleV2Avx2(const short* near, const short* far, short* output, int count, int shift);
+void fancyUpsampleH2Avx2(const short* samples, short* output, int count, int shift);
+void replicateH2Avx2(const short* samples, short* output, int count);
+void colorConvertAvx2(const short* y, const short* cb, const short* cr, unsigned char* output, int count, enum pixelFormat format);
+void storeSamplesAvx2(const short* samples, unsigned char* output, int count);
+void expandGrayAvx2(const short* y, unsigned char* output, int count, enum pixelFormat format);
+#endif
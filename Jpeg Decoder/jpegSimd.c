@@ -0,0 +1,799 @@
+#include <string.h>
+#include "jpegKernels.h"
+
+#ifdef JPEG_X86
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+TARGET_SSE2 static __m128i mulLowSse2(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+TARGET_SSE2 static __m128i mulConstSse2(__m128i a, int constant) {
+	return mulLowSse2(a, _mm_set1_epi32(constant));
+}
+
+TARGET_SSE2 static __m128i saturateInt16Sse2(__m128i a) {
+	__m128i packed = _mm_packs_epi32(a, a);
+	return _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+}
+
+TARGET_SSE2 static void loadCoefficientsSse2(const short* coefficients, __m128i* low, __m128i* high) {
+	__m128i values = _mm_load_si128((const __m128i*)coefficients);
+	*low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+	*high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+}
+
+TARGET_SSE2 static void transpose4x4Sse2(__m128i* a, __m128i* b, __m128i* c, __m128i* d) {
+	__m128i t0 = _mm_unpacklo_epi32(*a, *b);
+	__m128i t1 = _mm_unpacklo_epi32(*c, *d);
+	__m128i t2 = _mm_unpackhi_epi32(*a, *b);
+	__m128i t3 = _mm_unpackhi_epi32(*c, *d);
+	*a = _mm_unpacklo_epi64(t0, t1);
+	*b = _mm_unpackhi_epi64(t0, t1);
+	*c = _mm_unpacklo_epi64(t2, t3);
+	*d = _mm_unpackhi_epi64(t2, t3);
+}
+
+TARGET_SSE2 static void transpose8x8Sse2(__m128i* left, __m128i* right) {
+	transpose4x4Sse2(&left[0], &left[1], &left[2], &left[3]);
+	transpose4x4Sse2(&left[4], &left[5], &left[6], &left[7]);
+	transpose4x4Sse2(&right[0], &right[1], &right[2], &right[3]);
+	transpose4x4Sse2(&right[4], &right[5], &right[6], &right[7]);
+	for (int i = 0; i < 4; i++) {
+		__m128i swap = right[i];
+		right[i] = left[i + 4];
+		left[i + 4] = swap;
+	}
+}
+
+TARGET_SSE2 static void storeIdct1dIntegerSse2(__m128i* v, __m128i tmp10, __m128i tmp11, __m128i tmp12, __m128i tmp13, __m128i tmp0, __m128i tmp1, __m128i tmp2, __m128i tmp3, int shift) {
+	__m128i round = _mm_set1_epi32(1 << (shift - 1));
+	__m128i count = _mm_cvtsi32_si128(shift);
+	v[0] = _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(tmp10, tmp3), round), count);
+	v[7] = _mm_sra_epi32(_mm_add_epi32(_mm_sub_epi32(tmp10, tmp3), round), count);
+	v[1] = _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(tmp11, tmp2), round), count);
+	v[6] = _mm_sra_epi32(_mm_add_epi32(_mm_sub_epi32(tmp11, tmp2), round), count);
+	v[2] = _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(tmp12, tmp1), round), count);
+	v[5] = _mm_sra_epi32(_mm_add_epi32(_mm_sub_epi32(tmp12, tmp1), round), count);
+	v[3] = _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(tmp13, tmp0), round), count);
+	v[4] = _mm_sra_epi32(_mm_add_epi32(_mm_sub_epi32(tmp13, tmp0), round), count);
+}
+
+TARGET_SSE2 static void idct1dIntegerSse2(__m128i* v, int shift) {
+	__m128i z1 = mulConstSse2(_mm_add_epi32(v[2], v[6]), 4433);
+	__m128i tmp2 = _mm_sub_epi32(z1, mulConstSse2(v[6], 15137));
+	__m128i tmp3 = _mm_add_epi32(z1, mulConstSse2(v[2], 6270));
+	__m128i tmp0 = _mm_slli_epi32(_mm_add_epi32(v[0], v[4]), IDCT_CONST_BITS);
+	__m128i tmp1 = _mm_slli_epi32(_mm_sub_epi32(v[0], v[4]), IDCT_CONST_BITS);
+	__m128i tmp10 = _mm_add_epi32(tmp0, tmp3);
+	__m128i tmp13 = _mm_sub_epi32(tmp0, tmp3);
+	__m128i tmp11 = _mm_add_epi32(tmp1, tmp2);
+	__m128i tmp12 = _mm_sub_epi32(tmp1, tmp2);
+	z1 = _mm_add_epi32(v[7], v[1]);
+	__m128i z2 = _mm_add_epi32(v[5], v[3]);
+	__m128i z3 = _mm_add_epi32(v[7], v[3]);
+	__m128i z4 = _mm_add_epi32(v[5], v[1]);
+	__m128i z5 = mulConstSse2(_mm_add_epi32(z3, z4), 9633);
+	z1 = mulConstSse2(z1, -7373);
+	z2 = mulConstSse2(z2, -20995);
+	z3 = _mm_add_epi32(mulConstSse2(z3, -16069), z5);
+	z4 = _mm_add_epi32(mulConstSse2(z4, -3196), z5);
+	tmp0 = _mm_add_epi32(mulConstSse2(v[7], 2446), _mm_add_epi32(z1, z3));
+	tmp1 = _mm_add_epi32(mulConstSse2(v[5], 16819), _mm_add_epi32(z2, z4));
+	tmp2 = _mm_add_epi32(mulConstSse2(v[3], 25172), _mm_add_epi32(z2, z3));
+	tmp3 = _mm_add_epi32(mulConstSse2(v[1], 12299), _mm_add_epi32(z1, z4));
+	storeIdct1dIntegerSse2(v, tmp10, tmp11, tmp12, tmp13, tmp0, tmp1, tmp2, tmp3, shift);
+}
+
+TARGET_SSE2 static void idct1dInteger4Sse2(__m128i* v, int shift) {
+	__m128i z1 = mulConstSse2(v[2], 4433);
+	__m128i tmp2 = z1;
+	__m128i tmp3 = _mm_add_epi32(z1, mulConstSse2(v[2], 6270));
+	__m128i tmp0 = _mm_slli_epi32(v[0], IDCT_CONST_BITS);
+	__m128i tmp10 = _mm_add_epi32(tmp0, tmp3);
+	__m128i tmp13 = _mm_sub_epi32(tmp0, tmp3);
+	__m128i tmp11 = _mm_add_epi32(tmp0, tmp2);
+	__m128i tmp12 = _mm_sub_epi32(tmp0, tmp2);
+	__m128i z5 = mulConstSse2(_mm_add_epi32(v[3], v[1]), 9633);
+	z1 = mulConstSse2(v[1], -7373);
+	__m128i z2 = mulConstSse2(v[3], -20995);
+	__m128i z3 = _mm_add_epi32(mulConstSse2(v[3], -16069), z5);
+	__m128i z4 = _mm_add_epi32(mulConstSse2(v[1], -3196), z5);
+	tmp0 = _mm_add_epi32(z1, z3);
+	__m128i tmp1 = _mm_add_epi32(z2, z4);
+	tmp2 = _mm_add_epi32(mulConstSse2(v[3], 25172), _mm_add_epi32(z2, z3));
+	tmp3 = _mm_add_epi32(mulConstSse2(v[1], 12299), _mm_add_epi32(z1, z4));
+	storeIdct1dIntegerSse2(v, tmp10, tmp11, tmp12, tmp13, tmp0, tmp1, tmp2, tmp3, shift);
+}
+
+TARGET_SSE2 static void storeSampleRowsSse2(const __m128i* left, const __m128i* right, short output[8][8]) {
+	const __m128i bias = _mm_set1_epi32(128);
+	for (int row = 0; row < 8; row++) {
+		__m128i samples = _mm_packs_epi32(_mm_add_epi32(left[row], bias), _mm_add_epi32(right[row], bias));
+		_mm_storeu_si128((__m128i*)output[row], _mm_min_epi16(_mm_max_epi16(samples, _mm_setzero_si128()), _mm_set1_epi16(255)));
+	}
+}
+
+TARGET_SSE2 static void storeBlockIntegerSse2(__m128i* left, __m128i* right, short output[8][8]) {
+	transpose8x8Sse2(left, right);
+	storeSampleRowsSse2(left, right, output);
+}
+
+TARGET_SSE2 void idctIntegerSse2(const short* coefficients, const int* quant, short output[8][8]) {
+	__m128i left[8], right[8];
+	for (int row = 0; row < 8; row++) {
+		loadCoefficientsSse2(coefficients + row * 8, &left[row], &right[row]);
+		left[row] = saturateInt16Sse2(mulLowSse2(left[row], _mm_loadu_si128((const __m128i*)(quant + row * 8))));
+		right[row] = saturateInt16Sse2(mulLowSse2(right[row], _mm_loadu_si128((const __m128i*)(quant + row * 8 + 4))));
+	}
+	idct1dIntegerSse2(left, IDCT_CONST_BITS - IDCT_PASS1_BITS);
+	idct1dIntegerSse2(right, IDCT_CONST_BITS - IDCT_PASS1_BITS);
+	for (int row = 0; row < 8; row++) {
+		left[row] = saturateInt16Sse2(left[row]);
+		right[row] = saturateInt16Sse2(right[row]);
+	}
+	transpose8x8Sse2(left, right);
+	idct1dIntegerSse2(left, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+	idct1dIntegerSse2(right, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+	storeBlockIntegerSse2(left, right, output);
+}
+
+TARGET_SSE2 void idctInteger4x4Sse2(const short* coefficients, const int* quant, short output[8][8]) {
+	__m128i left[8], right[8];
+	for (int row = 0; row < 4; row++) {
+		__m128i high;
+		loadCoefficientsSse2(coefficients + row * 8, &left[row], &high);
+		left[row] = saturateInt16Sse2(mulLowSse2(left[row], _mm_loadu_si128((const __m128i*)(quant + row * 8))));
+	}
+	idct1dInteger4Sse2(left, IDCT_CONST_BITS - IDCT_PASS1_BITS);
+	for (int row = 0; row < 8; row++) {
+		left[row] = saturateInt16Sse2(left[row]);
+	}
+	transpose4x4Sse2(&left[0], &left[1], &left[2], &left[3]);
+	transpose4x4Sse2(&left[4], &left[5], &left[6], &left[7]);
+	for (int i = 0; i < 4; i++) {
+		right[i] = left[i + 4];
+	}
+	idct1dInteger4Sse2(left, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+	idct1dInteger4Sse2(right, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+	storeBlockIntegerSse2(left, right, output);
+}
+
+TARGET_SSE2 static void storeIdct1dFloatSse2(__m128* v, __m128 tmp0, __m128 tmp1, __m128 tmp2, __m128 tmp3, __m128 tmp4, __m128 tmp5, __m128 tmp6, __m128 tmp7) {
+	v[0] = _mm_add_ps(tmp0, tmp7);
+	v[7] = _mm_sub_ps(tmp0, tmp7);
+	v[1] = _mm_add_ps(tmp1, tmp6);
+	v[6] = _mm_sub_ps(tmp1, tmp6);
+	v[2] = _mm_add_ps(tmp2, tmp5);
+	v[5] = _mm_sub_ps(tmp2, tmp5);
+	v[4] = _mm_add_ps(tmp3, tmp4);
+	v[3] = _mm_sub_ps(tmp3, tmp4);
+}
+
+TARGET_SSE2 static void idct1dFloatSse2(__m128* v) {
+	__m128 tmp10 = _mm_add_ps(v[0], v[4]);
+	__m128 tmp11 = _mm_sub_ps(v[0], v[4]);
+	__m128 tmp13 = _mm_add_ps(v[2], v[6]);
+	__m128 tmp12 = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(v[2], v[6]), _mm_set1_ps(1.414213562f)), tmp13);
+	__m128 tmp0 = _mm_add_ps(tmp10, tmp13);
+	__m128 tmp3 = _mm_sub_ps(tmp10, tmp13);
+	__m128 tmp1 = _mm_add_ps(tmp11, tmp12);
+	__m128 tmp2 = _mm_sub_ps(tmp11, tmp12);
+	__m128 z13 = _mm_add_ps(v[5], v[3]);
+	__m128 z10 = _mm_sub_ps(v[5], v[3]);
+	__m128 z11 = _mm_add_ps(v[1], v[7]);
+	__m128 z12 = _mm_sub_ps(v[1], v[7]);
+	__m128 tmp7 = _mm_add_ps(z11, z13);
+	tmp11 = _mm_mul_ps(_mm_sub_ps(z11, z13), _mm_set1_ps(1.414213562f));
+	__m128 z5 = _mm_mul_ps(_mm_add_ps(z10, z12), _mm_set1_ps(1.847759065f));
+	tmp10 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.082392200f), z12), z5);
+	tmp12 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.613125930f), z10), z5);
+	__m128 tmp6 = _mm_sub_ps(tmp12, tmp7);
+	__m128 tmp5 = _mm_sub_ps(tmp11, tmp6);
+	__m128 tmp4 = _mm_add_ps(tmp10, tmp5);
+	storeIdct1dFloatSse2(v, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7);
+}
+
+TARGET_SSE2 static void idct1dFloat4Sse2(__m128* v) {
+	__m128 tmp12 = _mm_sub_ps(_mm_mul_ps(v[2], _mm_set1_ps(1.414213562f)), v[2]);
+	__m128 tmp0 = _mm_add_ps(v[0], v[2]);
+	__m128 tmp3 = _mm_sub_ps(v[0], v[2]);
+	__m128 tmp1 = _mm_add_ps(v[0], tmp12);
+	__m128 tmp2 = _mm_sub_ps(v[0], tmp12);
+	__m128 tmp7 = _mm_add_ps(v[1], v[3]);
+	__m128 difference = _mm_sub_ps(v[1], v[3]);
+	__m128 tmp11 = _mm_mul_ps(difference, _mm_set1_ps(1.414213562f));
+	__m128 z5 = _mm_mul_ps(difference, _mm_set1_ps(1.847759065f));
+	__m128 tmp10 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.082392200f), v[1]), z5);
+	tmp12 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.613125930f), v[3]), z5);
+	__m128 tmp6 = _mm_sub_ps(tmp12, tmp7);
+	__m128 tmp5 = _mm_sub_ps(tmp11, tmp6);
+	__m128 tmp4 = _mm_add_ps(tmp10, tmp5);
+	storeIdct1dFloatSse2(v, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7);
+}
+
+TARGET_SSE2 static __m128i roundSse2(__m128 x) {
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-256.0f)), _mm_set1_ps(256.0f));
+	__m128 half = _mm_or_ps(_mm_and_ps(x, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f));
+	return _mm_cvttps_epi32(_mm_add_ps(x, half));
+}
+
+TARGET_SSE2 static void transpose8x8FloatSse2(__m128* left, __m128* right) {
+	_MM_TRANSPOSE4_PS(left[0], left[1], left[2], left[3]);
+	_MM_TRANSPOSE4_PS(left[4], left[5], left[6], left[7]);
+	_MM_TRANSPOSE4_PS(right[0], right[1], right[2], right[3]);
+	_MM_TRANSPOSE4_PS(right[4], right[5], right[6], right[7]);
+	for (int i = 0; i < 4; i++) {
+		__m128 swap = right[i];
+		right[i] = left[i + 4];
+		left[i + 4] = swap;
+	}
+}
+
+TARGET_SSE2 static void storeBlockFloatSse2(__m128* left, __m128* right, short output[8][8]) {
+	transpose8x8FloatSse2(left, right);
+	__m128i leftSamples[8], rightSamples[8];
+	for (int row = 0; row < 8; row++) {
+		leftSamples[row] = roundSse2(left[row]);
+		rightSamples[row] = roundSse2(right[row]);
+	}
+	storeSampleRowsSse2(leftSamples, rightSamples, output);
+}
+
+TARGET_SSE2 void idctFloatSse2(const short* coefficients, const float* quant, short output[8][8]) {
+	__m128 left[8], right[8];
+	for (int row = 0; row < 8; row++) {
+		__m128i low, high;
+		loadCoefficientsSse2(coefficients + row * 8, &low, &high);
+		left[row] = _mm_mul_ps(_mm_cvtepi32_ps(low), _mm_loadu_ps(quant + row * 8));
+		right[row] = _mm_mul_ps(_mm_cvtepi32_ps(high), _mm_loadu_ps(quant + row * 8 + 4));
+	}
+	idct1dFloatSse2(left);
+	idct1dFloatSse2(right);
+	transpose8x8FloatSse2(left, right);
+	idct1dFloatSse2(left);
+	idct1dFloatSse2(right);
+	storeBlockFloatSse2(left, right, output);
+}
+
+TARGET_SSE2 void idctFloat4x4Sse2(const short* coefficients, const float* quant, short output[8][8]) {
+	__m128 left[8], right[8];
+	for (int row = 0; row < 4; row++) {
+		__m128i low, high;
+		loadCoefficientsSse2(coefficients + row * 8, &low, &high);
+		left[row] = _mm_mul_ps(_mm_cvtepi32_ps(low), _mm_loadu_ps(quant + row * 8));
+	}
+	idct1dFloat4Sse2(left);
+	_MM_TRANSPOSE4_PS(left[0], left[1], left[2], left[3]);
+	_MM_TRANSPOSE4_PS(left[4], left[5], left[6], left[7]);
+	for (int i = 0; i < 4; i++) {
+		right[i] = left[i + 4];
+	}
+	idct1dFloat4Sse2(left);
+	idct1dFloat4Sse2(right);
+	storeBlockFloatSse2(left, right, output);
+}
+
+TARGET_SSE2 void fancyUpsampleV2Sse2(const short* near, const short* far, short* output, int count, int shift) {
+	const __m128i round = _mm_set1_epi16((short)((1 << shift) >> 1));
+	const __m128i bits = _mm_cvtsi32_si128(shift);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i values = _mm_loadu_si128((const __m128i*)(near + i));
+		__m128i sum = _mm_add_epi16(_mm_add_epi16(values, _mm_slli_epi16(values, 1)), _mm_loadu_si128((const __m128i*)(far + i)));
+		_mm_storeu_si128((__m128i*)(output + i), _mm_srl_epi16(_mm_add_epi16(sum, round), bits));
+	}
+	if (i < count) {
+		fancyUpsampleV2Scalar(near + i, far + i, output + i, count - i, shift);
+	}
+}
+
+TARGET_SSE2 void fancyUpsampleH2Sse2(const short* samples, short* output, int count, int shift) {
+	const __m128i round = _mm_set1_epi16((short)((1 << shift) >> 1));
+	const __m128i bits = _mm_cvtsi32_si128(shift);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i values = _mm_loadu_si128((const __m128i*)(samples + i));
+		__m128i center = _mm_add_epi16(_mm_add_epi16(values, _mm_slli_epi16(values, 1)), round);
+		__m128i even = _mm_srl_epi16(_mm_add_epi16(center, _mm_loadu_si128((const __m128i*)(samples + i - 1))), bits);
+		__m128i odd = _mm_srl_epi16(_mm_add_epi16(center, _mm_loadu_si128((const __m128i*)(samples + i + 1))), bits);
+		_mm_storeu_si128((__m128i*)(output + i * 2), _mm_unpacklo_epi16(even, odd));
+		_mm_storeu_si128((__m128i*)(output + i * 2 + 8), _mm_unpackhi_epi16(even, odd));
+	}
+	if (i < count) {
+		fancyUpsampleH2Scalar(samples + i, output + i * 2, count - i, shift);
+	}
+}
+
+TARGET_SSE2 void replicateH2Sse2(const short* samples, short* output, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i values = _mm_loadu_si128((const __m128i*)(samples + i));
+		_mm_storeu_si128((__m128i*)(output + i * 2), _mm_unpacklo_epi16(values, values));
+		_mm_storeu_si128((__m128i*)(output + i * 2 + 8), _mm_unpackhi_epi16(values, values));
+	}
+	if (i < count) {
+		replicateH2Scalar(samples + i, output + i * 2, count - i);
+	}
+}
+
+TARGET_SSE2 static __m128i scaleChromaSse2(__m128i first, __m128i second, __m128i weights) {
+	const __m128i half = _mm_set1_epi32(1 << (COLOR_SCALE_BITS - 1));
+	__m128i low = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(first, second), weights), half), COLOR_SCALE_BITS);
+	__m128i high = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(first, second), weights), half), COLOR_SCALE_BITS);
+	return _mm_packs_epi32(low, high);
+}
+
+TARGET_SSE2 static void colorConvert8Sse2(const short* y, const short* cb, const short* cr, __m128i* r, __m128i* g, __m128i* b) {
+	const __m128i center = _mm_set1_epi16(128);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i Y = _mm_loadu_si128((const __m128i*)y);
+	__m128i Cb = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)cb), center);
+	__m128i Cr = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)cr), center);
+	*r = _mm_add_epi16(Y, scaleChromaSse2(Cr, zero, _mm_set1_epi32(COLOR_RED_CR & 0xFFFF)));
+	*g = _mm_add_epi16(Y, scaleChromaSse2(Cb, Cr, _mm_set1_epi32((COLOR_GREEN_CB & 0xFFFF) | COLOR_GREEN_CR * 65536)));
+	*b = _mm_add_epi16(Y, scaleChromaSse2(Cb, zero, _mm_set1_epi32(COLOR_BLUE_CB & 0xFFFF)));
+}
+
+TARGET_SSE2 static void storeQuadsSse2(unsigned char* output, __m128i first, __m128i second, __m128i third, __m128i fourth) {
+	__m128i low = _mm_unpacklo_epi8(first, second);
+	__m128i high = _mm_unpackhi_epi8(first, second);
+	__m128i lowRest = _mm_unpacklo_epi8(third, fourth);
+	__m128i highRest = _mm_unpackhi_epi8(third, fourth);
+	_mm_storeu_si128((__m128i*)output, _mm_unpacklo_epi16(low, lowRest));
+	_mm_storeu_si128((__m128i*)(output + 16), _mm_unpackhi_epi16(low, lowRest));
+	_mm_storeu_si128((__m128i*)(output + 32), _mm_unpacklo_epi16(high, highRest));
+	_mm_storeu_si128((__m128i*)(output + 48), _mm_unpackhi_epi16(high, highRest));
+}
+
+TARGET_SSE2 static void storePixelsSse2(unsigned char* output, __m128i r, __m128i g, __m128i b, enum pixelFormat format) {
+	if (format == PIXEL_RGBA32) {
+		storeQuadsSse2(output, r, g, b, _mm_set1_epi8(-1));
+	} else if (format == PIXEL_BGRA32) {
+		storeQuadsSse2(output, b, g, r, _mm_set1_epi8(-1));
+	} else {
+		unsigned char red[16], green[16], blue[16];
+		_mm_storeu_si128((__m128i*)red, r);
+		_mm_storeu_si128((__m128i*)green, g);
+		_mm_storeu_si128((__m128i*)blue, b);
+		for (int i = 0; i < 16; i++) {
+			*output++ = red[i];
+			*output++ = green[i];
+			*output++ = blue[i];
+		}
+	}
+}
+
+TARGET_SSE2 void colorConvertSse2(const short* y, const short* cb, const short* cr, unsigned char* output, int count, enum pixelFormat format) {
+	int pixelSize = format == PIXEL_RGB24 ? 3 : 4;
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i r0, g0, b0, r1, g1, b1;
+		colorConvert8Sse2(y + i, cb + i, cr + i, &r0, &g0, &b0);
+		colorConvert8Sse2(y + i + 8, cb + i + 8, cr + i + 8, &r1, &g1, &b1);
+		storePixelsSse2(output + i * pixelSize, _mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1), format);
+	}
+	if (i < count) {
+		colorConvertScalar(y + i, cb + i, cr + i, output + i * pixelSize, count - i, format);
+	}
+}
+
+TARGET_SSE2 void storeSamplesSse2(const short* samples, unsigned char* output, int count) {
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		_mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(_mm_loadu_si128((const __m128i*)(samples + i)), _mm_loadu_si128((const __m128i*)(samples + i + 8))));
+	}
+	if (i < count) {
+		storeSamplesScalar(samples + i, output + i, count - i);
+	}
+}
+
+TARGET_SSE2 void expandGraySse2(const short* y, unsigned char* output, int count, enum pixelFormat format) {
+	int pixelSize = format == PIXEL_RGB24 ? 3 : 4;
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i gray = _mm_packus_epi16(_mm_loadu_si128((const __m128i*)(y + i)), _mm_loadu_si128((const __m128i*)(y + i + 8)));
+		storePixelsSse2(output + i * pixelSize, gray, gray, gray, format);
+	}
+	if (i < count) {
+		expandGrayScalar(y + i, output + i * pixelSize, count - i, format);
+	}
+}
+
+TARGET_AVX2 static void transpose8x8Avx2(__m256i* v) {
+	__m256i t0 = _mm256_unpacklo_epi32(v[0], v[1]);
+	__m256i t1 = _mm256_unpackhi_epi32(v[0], v[1]);
+	__m256i t2 = _mm256_unpacklo_epi32(v[2], v[3]);
+	__m256i t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+	__m256i t4 = _mm256_unpacklo_epi32(v[4], v[5]);
+	__m256i t5 = _mm256_unpackhi_epi32(v[4], v[5]);
+	__m256i t6 = _mm256_unpacklo_epi32(v[6], v[7]);
+	__m256i t7 = _mm256_unpackhi_epi32(v[6], v[7]);
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+	v[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	v[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	v[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	v[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	v[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	v[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	v[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	v[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+TARGET_AVX2 static __m256i mulConstAvx2(__m256i a, int constant) {
+	return _mm256_mullo_epi32(a, _mm256_set1_epi32(constant));
+}
+
+TARGET_AVX2 static __m256i saturateInt16Avx2(__m256i a) {
+	return _mm256_max_epi32(_mm256_min_epi32(a, _mm256_set1_epi32(32767)), _mm256_set1_epi32(-32768));
+}
+
+TARGET_AVX2 static void storeIdct1dIntegerAvx2(__m256i* v, __m256i tmp10, __m256i tmp11, __m256i tmp12, __m256i tmp13, __m256i tmp0, __m256i tmp1, __m256i tmp2, __m256i tmp3, int shift) {
+	__m256i round = _mm256_set1_epi32(1 << (shift - 1));
+	__m128i count = _mm_cvtsi32_si128(shift);
+	v[0] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_add_epi32(tmp10, tmp3), round), count);
+	v[7] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp10, tmp3), round), count);
+	v[1] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_add_epi32(tmp11, tmp2), round), count);
+	v[6] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp11, tmp2), round), count);
+	v[2] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_add_epi32(tmp12, tmp1), round), count);
+	v[5] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp12, tmp1), round), count);
+	v[3] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_add_epi32(tmp13, tmp0), round), count);
+	v[4] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp13, tmp0), round), count);
+}
+
+TARGET_AVX2 static void idct1dIntegerAvx2(__m256i* v, int shift) {
+	__m256i z1 = mulConstAvx2(_mm256_add_epi32(v[2], v[6]), 4433);
+	__m256i tmp2 = _mm256_sub_epi32(z1, mulConstAvx2(v[6], 15137));
+	__m256i tmp3 = _mm256_add_epi32(z1, mulConstAvx2(v[2], 6270));
+	__m256i tmp0 = _mm256_slli_epi32(_mm256_add_epi32(v[0], v[4]), IDCT_CONST_BITS);
+	__m256i tmp1 = _mm256_slli_epi32(_mm256_sub_epi32(v[0], v[4]), IDCT_CONST_BITS);
+	__m256i tmp10 = _mm256_add_epi32(tmp0, tmp3);
+	__m256i tmp13 = _mm256_sub_epi32(tmp0, tmp3);
+	__m256i tmp11 = _mm256_add_epi32(tmp1, tmp2);
+	__m256i tmp12 = _mm256_sub_epi32(tmp1, tmp2);
+	z1 = _mm256_add_epi32(v[7], v[1]);
+	__m256i z2 = _mm256_add_epi32(v[5], v[3]);
+	__m256i z3 = _mm256_add_epi32(v[7], v[3]);
+	__m256i z4 = _mm256_add_epi32(v[5], v[1]);
+	__m256i z5 = mulConstAvx2(_mm256_add_epi32(z3, z4), 9633);
+	z1 = mulConstAvx2(z1, -7373);
+	z2 = mulConstAvx2(z2, -20995);
+	z3 = _mm256_add_epi32(mulConstAvx2(z3, -16069), z5);
+	z4 = _mm256_add_epi32(mulConstAvx2(z4, -3196), z5);
+	tmp0 = _mm256_add_epi32(mulConstAvx2(v[7], 2446), _mm256_add_epi32(z1, z3));
+	tmp1 = _mm256_add_epi32(mulConstAvx2(v[5], 16819), _mm256_add_epi32(z2, z4));
+	tmp2 = _mm256_add_epi32(mulConstAvx2(v[3], 25172), _mm256_add_epi32(z2, z3));
+	tmp3 = _mm256_add_epi32(mulConstAvx2(v[1], 12299), _mm256_add_epi32(z1, z4));
+	storeIdct1dIntegerAvx2(v, tmp10, tmp11, tmp12, tmp13, tmp0, tmp1, tmp2, tmp3, shift);
+}
+
+TARGET_AVX2 static void idct1dInteger4Avx2(__m256i* v, int shift) {
+	__m256i z1 = mulConstAvx2(v[2], 4433);
+	__m256i tmp2 = z1;
+	__m256i tmp3 = _mm256_add_epi32(z1, mulConstAvx2(v[2], 6270));
+	__m256i tmp0 = _mm256_slli_epi32(v[0], IDCT_CONST_BITS);
+	__m256i tmp10 = _mm256_add_epi32(tmp0, tmp3);
+	__m256i tmp13 = _mm256_sub_epi32(tmp0, tmp3);
+	__m256i tmp11 = _mm256_add_epi32(tmp0, tmp2);
+	__m256i tmp12 = _mm256_sub_epi32(tmp0, tmp2);
+	__m256i z5 = mulConstAvx2(_mm256_add_epi32(v[3], v[1]), 9633);
+	z1 = mulConstAvx2(v[1], -7373);
+	__m256i z2 = mulConstAvx2(v[3], -20995);
+	__m256i z3 = _mm256_add_epi32(mulConstAvx2(v[3], -16069), z5);
+	__m256i z4 = _mm256_add_epi32(mulConstAvx2(v[1], -3196), z5);
+	tmp0 = _mm256_add_epi32(z1, z3);
+	__m256i tmp1 = _mm256_add_epi32(z2, z4);
+	tmp2 = _mm256_add_epi32(mulConstAvx2(v[3], 25172), _mm256_add_epi32(z2, z3));
+	tmp3 = _mm256_add_epi32(mulConstAvx2(v[1], 12299), _mm256_add_epi32(z1, z4));
+	storeIdct1dIntegerAvx2(v, tmp10, tmp11, tmp12, tmp13, tmp0, tmp1, tmp2, tmp3, shift);
+}
+
+TARGET_AVX2 static void storeSampleRowsAvx2(const __m256i* v, short output[8][8]) {
+	const __m256i bias = _mm256_set1_epi32(128);
+	for (int row = 0; row < 8; row += 2) {
+		__m256i samples = _mm256_packs_epi32(_mm256_add_epi32(v[row], bias), _mm256_add_epi32(v[row + 1], bias));
+		samples = _mm256_permute4x64_epi64(samples, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)output[row], _mm256_min_epi16(_mm256_max_epi16(samples, _mm256_setzero_si256()), _mm256_set1_epi16(255)));
+	}
+}
+
+TARGET_AVX2 static void storeBlockIntegerAvx2(__m256i* v, short output[8][8]) {
+	transpose8x8Avx2(v);
+	storeSampleRowsAvx2(v, output);
+}
+
+TARGET_AVX2 void idctIntegerAvx2(const short* coefficients, const int* quant, short output[8][8]) {
+	__m256i v[8];
+	for (int row = 0; row < 8; row++) {
+		__m256i values = _mm256_cvtepi16_epi32(_mm_load_si128((const __m128i*)(coefficients + row * 8)));
+		v[row] = saturateInt16Avx2(_mm256_mullo_epi32(values, _mm256_loadu_si256((const __m256i*)(quant + row * 8))));
+	}
+	idct1dIntegerAvx2(v, IDCT_CONST_BITS - IDCT_PASS1_BITS);
+	for (int row = 0; row < 8; row++) {
+		v[row] = saturateInt16Avx2(v[row]);
+	}
+	transpose8x8Avx2(v);
+	idct1dIntegerAvx2(v, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+	storeBlockIntegerAvx2(v, output);
+}
+
+TARGET_AVX2 void idctInteger4x4Avx2(const short* coefficients, const int* quant, short output[8][8]) {
+	__m256i v[8];
+	for (int row = 0; row < 4; row++) {
+		__m256i values = _mm256_cvtepi16_epi32(_mm_load_si128((const __m128i*)(coefficients + row * 8)));
+		v[row] = saturateInt16Avx2(_mm256_mullo_epi32(values, _mm256_loadu_si256((const __m256i*)(quant + row * 8))));
+	}
+	idct1dInteger4Avx2(v, IDCT_CONST_BITS - IDCT_PASS1_BITS);
+	for (int row = 0; row < 8; row++) {
+		v[row] = saturateInt16Avx2(v[row]);
+	}
+	transpose8x8Avx2(v);
+	idct1dInteger4Avx2(v, IDCT_CONST_BITS + IDCT_PASS1_BITS + 3);
+	storeBlockIntegerAvx2(v, output);
+}
+
+TARGET_AVX2 static void storeIdct1dFloatAvx2(__m256* v, __m256 tmp0, __m256 tmp1, __m256 tmp2, __m256 tmp3, __m256 tmp4, __m256 tmp5, __m256 tmp6, __m256 tmp7) {
+	v[0] = _mm256_add_ps(tmp0, tmp7);
+	v[7] = _mm256_sub_ps(tmp0, tmp7);
+	v[1] = _mm256_add_ps(tmp1, tmp6);
+	v[6] = _mm256_sub_ps(tmp1, tmp6);
+	v[2] = _mm256_add_ps(tmp2, tmp5);
+	v[5] = _mm256_sub_ps(tmp2, tmp5);
+	v[4] = _mm256_add_ps(tmp3, tmp4);
+	v[3] = _mm256_sub_ps(tmp3, tmp4);
+}
+
+TARGET_AVX2 static void idct1dFloatAvx2(__m256* v) {
+	__m256 tmp10 = _mm256_add_ps(v[0], v[4]);
+	__m256 tmp11 = _mm256_sub_ps(v[0], v[4]);
+	__m256 tmp13 = _mm256_add_ps(v[2], v[6]);
+	__m256 tmp12 = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(v[2], v[6]), _mm256_set1_ps(1.414213562f)), tmp13);
+	__m256 tmp0 = _mm256_add_ps(tmp10, tmp13);
+	__m256 tmp3 = _mm256_sub_ps(tmp10, tmp13);
+	__m256 tmp1 = _mm256_add_ps(tmp11, tmp12);
+	__m256 tmp2 = _mm256_sub_ps(tmp11, tmp12);
+	__m256 z13 = _mm256_add_ps(v[5], v[3]);
+	__m256 z10 = _mm256_sub_ps(v[5], v[3]);
+	__m256 z11 = _mm256_add_ps(v[1], v[7]);
+	__m256 z12 = _mm256_sub_ps(v[1], v[7]);
+	__m256 tmp7 = _mm256_add_ps(z11, z13);
+	tmp11 = _mm256_mul_ps(_mm256_sub_ps(z11, z13), _mm256_set1_ps(1.414213562f));
+	__m256 z5 = _mm256_mul_ps(_mm256_add_ps(z10, z12), _mm256_set1_ps(1.847759065f));
+	tmp10 = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(1.082392200f), z12), z5);
+	tmp12 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-2.613125930f), z10), z5);
+	__m256 tmp6 = _mm256_sub_ps(tmp12, tmp7);
+	__m256 tmp5 = _mm256_sub_ps(tmp11, tmp6);
+	__m256 tmp4 = _mm256_add_ps(tmp10, tmp5);
+	storeIdct1dFloatAvx2(v, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7);
+}
+
+TARGET_AVX2 static void idct1dFloat4Avx2(__m256* v) {
+	__m256 tmp12 = _mm256_sub_ps(_mm256_mul_ps(v[2], _mm256_set1_ps(1.414213562f)), v[2]);
+	__m256 tmp0 = _mm256_add_ps(v[0], v[2]);
+	__m256 tmp3 = _mm256_sub_ps(v[0], v[2]);
+	__m256 tmp1 = _mm256_add_ps(v[0], tmp12);
+	__m256 tmp2 = _mm256_sub_ps(v[0], tmp12);
+	__m256 tmp7 = _mm256_add_ps(v[1], v[3]);
+	__m256 difference = _mm256_sub_ps(v[1], v[3]);
+	__m256 tmp11 = _mm256_mul_ps(difference, _mm256_set1_ps(1.414213562f));
+	__m256 z5 = _mm256_mul_ps(difference, _mm256_set1_ps(1.847759065f));
+	__m256 tmp10 = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(1.082392200f), v[1]), z5);
+	tmp12 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(2.613125930f), v[3]), z5);
+	__m256 tmp6 = _mm256_sub_ps(tmp12, tmp7);
+	__m256 tmp5 = _mm256_sub_ps(tmp11, tmp6);
+	__m256 tmp4 = _mm256_add_ps(tmp10, tmp5);
+	storeIdct1dFloatAvx2(v, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7);
+}
+
+TARGET_AVX2 static void transpose8x8FloatAvx2(__m256* v) {
+	__m256i cast[8];
+	for (int i = 0; i < 8; i++) {
+		cast[i] = _mm256_castps_si256(v[i]);
+	}
+	transpose8x8Avx2(cast);
+	for (int i = 0; i < 8; i++) {
+		v[i] = _mm256_castsi256_ps(cast[i]);
+	}
+}
+
+TARGET_AVX2 static void storeBlockFloatAvx2(__m256* v, short output[8][8]) {
+	transpose8x8FloatAvx2(v);
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256i samples[8];
+	for (int row = 0; row < 8; row++) {
+		__m256 x = _mm256_min_ps(_mm256_max_ps(v[row], _mm256_set1_ps(-256.0f)), _mm256_set1_ps(256.0f));
+		__m256 half = _mm256_or_ps(_mm256_and_ps(x, signMask), _mm256_set1_ps(0.5f));
+		samples[row] = _mm256_cvttps_epi32(_mm256_add_ps(x, half));
+	}
+	storeSampleRowsAvx2(samples, output);
+}
+
+TARGET_AVX2 void idctFloatAvx2(const short* coefficients, const float* quant, short output[8][8]) {
+	__m256 v[8];
+	for (int row = 0; row < 8; row++) {
+		__m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_load_si128((const __m128i*)(coefficients + row * 8))));
+		v[row] = _mm256_mul_ps(values, _mm256_loadu_ps(quant + row * 8));
+	}
+	idct1dFloatAvx2(v);
+	transpose8x8FloatAvx2(v);
+	idct1dFloatAvx2(v);
+	storeBlockFloatAvx2(v, output);
+}
+
+TARGET_AVX2 void idctFloat4x4Avx2(const short* coefficients, const float* quant, short output[8][8]) {
+	__m256 v[8];
+	for (int row = 0; row < 4; row++) {
+		__m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_load_si128((const __m128i*)(coefficients + row * 8))));
+		v[row] = _mm256_mul_ps(values, _mm256_loadu_ps(quant + row * 8));
+	}
+	idct1dFloat4Avx2(v);
+	transpose8x8FloatAvx2(v);
+	idct1dFloat4Avx2(v);
+	storeBlockFloatAvx2(v, output);
+}
+
+TARGET_AVX2 void fancyUpsampleV2Avx2(const short* near, const short* far, short* output, int count, int shift) {
+	const __m256i round = _mm256_set1_epi16((short)((1 << shift) >> 1));
+	const __m128i bits = _mm_cvtsi32_si128(shift);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i values = _mm256_loadu_si256((const __m256i*)(near + i));
+		__m256i sum = _mm256_add_epi16(_mm256_add_epi16(values, _mm256_slli_epi16(values, 1)), _mm256_loadu_si256((const __m256i*)(far + i)));
+		_mm256_storeu_si256((__m256i*)(output + i), _mm256_srl_epi16(_mm256_add_epi16(sum, round), bits));
+	}
+	if (i < count) {
+		fancyUpsampleV2Sse2(near + i, far + i, output + i, count - i, shift);
+	}
+}
+
+TARGET_AVX2 static void storeInterleavedAvx2(short* output, __m256i even, __m256i odd) {
+	__m256i low = _mm256_unpacklo_epi16(even, odd);
+	__m256i high = _mm256_unpackhi_epi16(even, odd);
+	_mm256_storeu_si256((__m256i*)output, _mm256_permute2x128_si256(low, high, 0x20));
+	_mm256_storeu_si256((__m256i*)(output + 16), _mm256_permute2x128_si256(low, high, 0x31));
+}
+
+TARGET_AVX2 void fancyUpsampleH2Avx2(const short* samples, short* output, int count, int shift) {
+	const __m256i round = _mm256_set1_epi16((short)((1 << shift) >> 1));
+	const __m128i bits = _mm_cvtsi32_si128(shift);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i values = _mm256_loadu_si256((const __m256i*)(samples + i));
+		__m256i center = _mm256_add_epi16(_mm256_add_epi16(values, _mm256_slli_epi16(values, 1)), round);
+		__m256i even = _mm256_srl_epi16(_mm256_add_epi16(center, _mm256_loadu_si256((const __m256i*)(samples + i - 1))), bits);
+		__m256i odd = _mm256_srl_epi16(_mm256_add_epi16(center, _mm256_loadu_si256((const __m256i*)(samples + i + 1))), bits);
+		storeInterleavedAvx2(output + i * 2, even, odd);
+	}
+	if (i < count) {
+		fancyUpsampleH2Sse2(samples + i, output + i * 2, count - i, shift);
+	}
+}
+
+TARGET_AVX2 void replicateH2Avx2(const short* samples, short* output, int count) {
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i values = _mm256_loadu_si256((const __m256i*)(samples + i));
+		storeInterleavedAvx2(output + i * 2, values, values);
+	}
+	if (i < count) {
+		replicateH2Sse2(samples + i, output + i * 2, count - i);
+	}
+}
+
+TARGET_AVX2 static __m256i scaleChromaAvx2(__m256i first, __m256i second, __m256i weights) {
+	const __m256i half = _mm256_set1_epi32(1 << (COLOR_SCALE_BITS - 1));
+	__m256i low = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(first, second), weights), half), COLOR_SCALE_BITS);
+	__m256i high = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(first, second), weights), half), COLOR_SCALE_BITS);
+	return _mm256_packs_epi32(low, high);
+}
+
+TARGET_AVX2 static void colorConvert16Avx2(const short* y, const short* cb, const short* cr, __m256i* r, __m256i* g, __m256i* b) {
+	const __m256i center = _mm256_set1_epi16(128);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i Y = _mm256_loadu_si256((const __m256i*)y);
+	__m256i Cb = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)cb), center);
+	__m256i Cr = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)cr), center);
+	*r = _mm256_add_epi16(Y, scaleChromaAvx2(Cr, zero, _mm256_set1_epi32(COLOR_RED_CR & 0xFFFF)));
+	*g = _mm256_add_epi16(Y, scaleChromaAvx2(Cb, Cr, _mm256_set1_epi32((COLOR_GREEN_CB & 0xFFFF) | COLOR_GREEN_CR * 65536)));
+	*b = _mm256_add_epi16(Y, scaleChromaAvx2(Cb, zero, _mm256_set1_epi32(COLOR_BLUE_CB & 0xFFFF)));
+}
+
+TARGET_AVX2 static __m256i packBytesAvx2(__m256i first, __m256i second) {
+	return _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+TARGET_AVX2 static void storeTriplesAvx2(unsigned char* output, __m128i r, __m128i g, __m128i b) {
+	const __m128i order = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	__m128i low = _mm_unpacklo_epi8(r, g);
+	__m128i high = _mm_unpackhi_epi8(r, g);
+	__m128i lowBlue = _mm_unpacklo_epi8(b, b);
+	__m128i highBlue = _mm_unpackhi_epi8(b, b);
+	__m128i first = _mm_shuffle_epi8(_mm_unpacklo_epi16(low, lowBlue), order);
+	__m128i second = _mm_shuffle_epi8(_mm_unpackhi_epi16(low, lowBlue), order);
+	__m128i third = _mm_shuffle_epi8(_mm_unpacklo_epi16(high, highBlue), order);
+	__m128i fourth = _mm_shuffle_epi8(_mm_unpackhi_epi16(high, highBlue), order);
+	_mm_storeu_si128((__m128i*)output, _mm_or_si128(first, _mm_slli_si128(second, 12)));
+	_mm_storeu_si128((__m128i*)(output + 16), _mm_or_si128(_mm_srli_si128(second, 4), _mm_slli_si128(third, 8)));
+	_mm_storeu_si128((__m128i*)(output + 32), _mm_or_si128(_mm_srli_si128(third, 8), _mm_slli_si128(fourth, 4)));
+}
+
+TARGET_AVX2 static void storeQuadsAvx2(unsigned char* output, __m256i first, __m256i second, __m256i third, __m256i fourth) {
+	__m256i low = _mm256_unpacklo_epi8(first, second);
+	__m256i high = _mm256_unpackhi_epi8(first, second);
+	__m256i lowRest = _mm256_unpacklo_epi8(third, fourth);
+	__m256i highRest = _mm256_unpackhi_epi8(third, fourth);
+	__m256i q0 = _mm256_unpacklo_epi16(low, lowRest);
+	__m256i q1 = _mm256_unpackhi_epi16(low, lowRest);
+	__m256i q2 = _mm256_unpacklo_epi16(high, highRest);
+	__m256i q3 = _mm256_unpackhi_epi16(high, highRest);
+	_mm256_storeu_si256((__m256i*)output, _mm256_permute2x128_si256(q0, q1, 0x20));
+	_mm256_storeu_si256((__m256i*)(output + 32), _mm256_permute2x128_si256(q2, q3, 0x20));
+	_mm256_storeu_si256((__m256i*)(output + 64), _mm256_permute2x128_si256(q0, q1, 0x31));
+	_mm256_storeu_si256((__m256i*)(output + 96), _mm256_permute2x128_si256(q2, q3, 0x31));
+}
+
+TARGET_AVX2 static void storePixelsAvx2(unsigned char* output, __m256i r, __m256i g, __m256i b, enum pixelFormat format) {
+	if (format == PIXEL_RGBA32) {
+		storeQuadsAvx2(output, r, g, b, _mm256_set1_epi8(-1));
+	} else if (format == PIXEL_BGRA32) {
+		storeQuadsAvx2(output, b, g, r, _mm256_set1_epi8(-1));
+	} else {
+		storeTriplesAvx2(output, _mm256_castsi256_si128(r), _mm256_castsi256_si128(g), _mm256_castsi256_si128(b));
+		storeTriplesAvx2(output + 48, _mm256_extracti128_si256(r, 1), _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(b, 1));
+	}
+}
+
+TARGET_AVX2 void colorConvertAvx2(const short* y, const short* cb, const short* cr, unsigned char* output, int count, enum pixelFormat format) {
+	int pixelSize = format == PIXEL_RGB24 ? 3 : 4;
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i r0, g0, b0, r1, g1, b1;
+		colorConvert16Avx2(y + i, cb + i, cr + i, &r0, &g0, &b0);
+		colorConvert16Avx2(y + i + 16, cb + i + 16, cr + i + 16, &r1, &g1, &b1);
+		storePixelsAvx2(output + i * pixelSize, packBytesAvx2(r0, r1), packBytesAvx2(g0, g1), packBytesAvx2(b0, b1), format);
+	}
+	if (i < count) {
+		colorConvertSse2(y + i, cb + i, cr + i, output + i * pixelSize, count - i, format);
+	}
+}
+
+TARGET_AVX2 void storeSamplesAvx2(const short* samples, unsigned char* output, int count) {
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		_mm256_storeu_si256((__m256i*)(output + i), packBytesAvx2(_mm256_loadu_si256((const __m256i*)(samples + i)), _mm256_loadu_si256((const __m256i*)(samples + i + 16))));
+	}
+	if (i < count) {
+		storeSamplesSse2(samples + i, output + i, count - i);
+	}
+}
+
+TARGET_AVX2 void expandGrayAvx2(const short* y, unsigned char* output, int count, enum pixelFormat format) {
+	int pixelSize = format == PIXEL_RGB24 ? 3 : 4;
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i gray = packBytesAvx2(_mm256_loadu_si256((const __m256i*)(y + i)), _mm256_loadu_si256((const __m256i*)(y + i + 16)));
+		storePixelsAvx2(output + i * pixelSize, gray, gray, gray, format);
+	}
+	if (i < count) {
+		expandGraySse2(y + i, output + i * pixelSize, count - i, format);
+	}
+}
+
+#endif
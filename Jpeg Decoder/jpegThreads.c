@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <threads.h>
+#include "jpegThreads.h"
+
+struct threadPool {
+	thrd_t* threads;
+	int numThreads;
+	mtx_t lock;
+	cnd_t wake;
+	cnd_t done;
+	void (*task)(void* context, int index);
+	void* context;
+	int nextTask;
+	int numTasks;
+	int pending;
+	bool stopping;
+};
+
+static void runNextTask(struct threadPool* pool) {
+	int index = pool->nextTask++;
+	void (*task)(void* context, int index) = pool->task;
+	void* context = pool->context;
+	mtx_unlock(&pool->lock);
+	task(context, index);
+	mtx_lock(&pool->lock);
+	if (--pool->pending == 0) {
+		cnd_broadcast(&pool->done);
+	}
+}
+
+static int workerMain(void* argument) {
+	struct threadPool* pool = (struct threadPool*)argument;
+	mtx_lock(&pool->lock);
+	while (!pool->stopping) {
+		if (pool->nextTask < pool->numTasks) {
+			runNextTask(pool);
+		} else {
+			cnd_wait(&pool->wake, &pool->lock);
+		}
+	}
+	mtx_unlock(&pool->lock);
+	return 0;
+}
+
+struct threadPool* createThreadPool(int threads) {
+	if (threads < 2) {
+		return NULL;
+	}
+	struct threadPool* pool = (struct threadPool*)calloc(1, sizeof(struct threadPool));
+	if (!pool) {
+		return NULL;
+	}
+	pool->threads = (thrd_t*)malloc(sizeof(thrd_t) * (threads - 1));
+	if (!pool->threads || mtx_init(&pool->lock, mtx_plain) != thrd_success) {
+		free(pool->threads);
+		free(pool);
+		return NULL;
+	}
+	cnd_init(&pool->wake);
+	cnd_init(&pool->done);
+	for (int i = 0; i < threads - 1; i++) {
+		if (thrd_create(&pool->threads[pool->numThreads], workerMain, pool) == thrd_success) {
+			pool->numThreads++;
+		}
+	}
+	return pool;
+}
+
+void destroyThreadPool(struct threadPool* pool) {
+	if (!pool) {
+		return;
+	}
+	mtx_lock(&pool->lock);
+	pool->stopping = true;
+	cnd_broadcast(&pool->wake);
+	mtx_unlock(&pool->lock);
+	for (int i = 0; i < pool->numThreads; i++) {
+		thrd_join(pool->threads[i], NULL);
+	}
+	cnd_destroy(&pool->wake);
+	cnd_destroy(&pool->done);
+	mtx_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
+
+int threadCount(const struct threadPool* pool) {
+	return pool ? pool->numThreads + 1 : 1;
+}
+
+void runTasks(struct threadPool* pool, int count, void (*task)(void* context, int index), void* context) {
+	if (!pool) {
+		for (int i = 0; i < count; i++) {
+			task(context, i);
+		}
+		return;
+	}
+	mtx_lock(&pool->lock);
+	pool->task = task;
+	pool->context = context;
+	pool->nextTask = 0;
+	pool->numTasks = count;
+	pool->pending = count;
+	cnd_broadcast(&pool->wake);
+	while (pool->pending > 0) {
+		if (pool->nextTask < pool->numTasks) {
+			runNextTask(pool);
+		} else {
+			cnd_wait(&pool->done, &pool->lock);
+		}
+	}
+	pool->numTasks = 0;
+	pool->nextTask = 0;
+	mtx_unlock(&pool->lock);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+struct threadPool;
+
+struct threadPool* createThreadPool(int threads);
+void destroyThreadPool(struct threadPool* pool);
+int threadCount(const struct threadPool* pool);
+void runTasks(struct threadPool* pool, int count, void (*task)(void* context, int index), void* context);
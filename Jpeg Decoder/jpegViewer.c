@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#include "jpegDecoder.h"
+
+struct viewer {
+	SDL_Window* window;
+	SDL_Renderer* renderer;
+	SDL_Texture* texture;
+};
+
+void updateRegion(void* user, const unsigned char* pixels, size_t stride, int x, int y, int width, int height) {
+	struct viewer* viewer = (struct viewer*)user;
+	SDL_Rect rect = { x, y, width, height };
+	SDL_UpdateTexture(viewer->texture, &rect, pixels + y * stride + x * 4, (int)stride);
+}
+
+void presentScan(void* user, const unsigned char* pixels, int width, int height, size_t stride) {
+	struct viewer* viewer = (struct viewer*)user;
+	SDL_RenderClear(viewer->renderer);
+	SDL_RenderTexture(viewer->renderer, viewer->texture, NULL, NULL);
+	SDL_RenderPresent(viewer->renderer);
+}
+
+int main(int argc, char* argv[]) {
+	struct jpegOptions options;
+	struct viewer viewer = { NULL, NULL, NULL };
+	jpegDefaultOptions(&options);
+	int arg = 1;
+	while (arg + 1 < argc && argv[arg][0] == '-') {
+		if (strcmp(argv[arg], "-idct") == 0) {
+			if (strcmp(argv[arg + 1], "float") == 0) {
+				options.idctMethod = IDCT_FLOAT;
+			} else if (strcmp(argv[arg + 1], "int") != 0) {
+				printf("unknown idct method %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else if (strcmp(argv[arg], "-simd") == 0) {
+			if (strcmp(argv[arg + 1], "none") == 0) {
+				options.simdLevel = SIMD_NONE;
+			} else if (strcmp(argv[arg + 1], "sse2") == 0) {
+				options.simdLevel = SIMD_SSE2;
+			} else if (strcmp(argv[arg + 1], "avx2") != 0) {
+				printf("unknown simd level %s\n", argv[arg + 1]);
+				return 1;
+			}
+		} else {
+			printf("unknown option %s\n", argv[arg]);
+			return 1;
+		}
+		arg += 2;
+	}
+	if (arg >= argc) {
+		printf("usage: %s [-idct int|float] [-simd none|sse2|avx2] <file.jpg>\n", argv[0]);
+		return 1;
+	}
+	options.progressiveMode = PROGRESSIVE_INCREMENTAL;
+	options.pixelFormat = PIXEL_BGRA32;
+	options.regionComplete = updateRegion;
+	options.scanComplete = presentScan;
+	options.user = &viewer;
+	struct jpegDecoder* decoder = jpegCreate(&options);
+	if (!decoder) {
+		printf("allocation failed\n");
+		return 1;
+	}
+	struct jpegInfo info;
+	enum jpegStatus status = jpegOpenFile(decoder, argv[arg]);
+	if (status == JPEG_OK) {
+		status = jpegReadHeader(decoder, &info);
+	}
+	if (status != JPEG_OK) {
+		printf("Error opening file %s: %s\n", argv[arg], jpegStatusString(status));
+		jpegDestroy(decoder);
+		return 1;
+	}
+	if (!SDL_Init(SDL_INIT_VIDEO)) {
+		printf("SDL failed to initialize\n");
+		printf("%s\n", SDL_GetError());
+		jpegDestroy(decoder);
+		return 1;
+	}
+	viewer.window = SDL_CreateWindow(argv[arg], info.width, info.height, 0);
+	viewer.renderer = SDL_CreateRenderer(viewer.window, NULL);
+	viewer.texture = SDL_CreateTexture(viewer.renderer, SDL_PIXELFORMAT_BGRA32, SDL_TEXTUREACCESS_STATIC, info.width, info.height);
+	size_t stride = (size_t)info.width * 4;
+	unsigned char* pixels = malloc(stride * info.height);
+	if (!pixels) {
+		printf("allocation failed\n");
+		status = JPEG_ERROR_MEMORY;
+	} else {
+		status = jpegDecode(decoder, pixels, stride);
+		if (status != JPEG_OK) {
+			printf("Error decoding %s: %s\n", argv[arg], jpegStatusString(status));
+		} else {
+			SDL_Event event;
+			while (SDL_WaitEvent(&event) && event.type != SDL_EVENT_QUIT) {
+			}
+		}
+	}
+	free(pixels);
+	jpegDestroy(decoder);
+	SDL_DestroyTexture(viewer.texture);
+	SDL_DestroyRenderer(viewer.renderer);
+	SDL_DestroyWindow(viewer.window);
+	SDL_Quit();
+	return status == JPEG_OK ? 0 : 1;
+}
@@ -0,0 +1,788 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "jpegDecoder.h"
+#include "jpegKernels.h"
+
+struct errorStats {
+	double squaredError;
+	double samples;
+	int maxError;
+};
+
+struct planeLayout {
+	int components;
+	size_t stride;
+	int widths[3];
+	int heights[3];
+};
+
+struct idctCase {
+	const char* name;
+	enum idctMethod method;
+	double minPsnr;
+	int maxError;
+};
+
+struct sparseCase {
+	const char* name;
+	int extent;
+	void (*idctInteger)(const short* coefficients, const int* quant, short output[8][8]);
+	void (*idctFloat)(const short* coefficients, const float* quant, short output[8][8]);
+};
+
+struct scaledCase {
+	const char* name;
+	int size;
+	void (*idct)(const short* coefficients, const int* quant, short output[8][8]);
+};
+
+struct formatCase {
+	const char* name;
+	enum pixelFormat format;
+};
+
+struct batchCheck {
+	unsigned char** references;
+	int* widths;
+	int* heights;
+	int* mismatches;
+};
+
+const char* simdNames[] = { "none", "sse2", "avx2" };
+
+const int luminanceQuant[64] = {
+	16, 11, 10, 16, 24, 40, 51, 61,
+	12, 12, 14, 19, 26, 58, 60, 55,
+	14, 13, 16, 24, 40, 57, 69, 56,
+	14, 17, 22, 29, 51, 87, 80, 62,
+	18, 22, 37, 56, 68, 109, 103, 77,
+	24, 35, 55, 64, 81, 104, 113, 92,
+	49, 64, 78, 87, 103, 121, 120, 101,
+	72, 92, 95, 98, 112, 100, 103, 99
+};
+
+const char* defaultImages[] = {
+	"arcane.jpg", "arcane2.jpg", "gwen.jpg", "sinners.jpg", "avengers.jpg", "vi.jpg", "test.jpg", "test2.jpg",
+	"arcaneProg.jpg", "gwenProg.jpg", "sinnersProg.jpg", "gwenRestart.jpg"
+};
+
+const struct idctCase idctCases[] = {
+	{ "int", IDCT_INTEGER, 55.0, 2 },
+	{ "float", IDCT_FLOAT, 55.0, 2 }
+};
+
+const struct scaledCase scaledCases[] = {
+	{ "4x4", 4, idctScaled4x4 },
+	{ "2x2", 2, idctScaled2x2 },
+	{ "1x1", 1, idctScaled1x1 }
+};
+
+const int scales[] = { 2, 4, 8 };
+
+const struct formatCase formatCases[] = {
+	{ "rgb", PIXEL_RGB24 },
+	{ "rgba", PIXEL_RGBA32 },
+	{ "bgra", PIXEL_BGRA32 },
+	{ "gray", PIXEL_GRAY8 },
+	{ "yuv", PIXEL_YUV_PLANAR }
+};
+
+unsigned char* decodePlanes(const char* path, enum idctMethod method, enum simdLevel level, int scale, struct planeLayout* layout) {
+	struct jpegOptions options;
+	jpegDefaultOptions(&options);
+	options.idctMethod = method;
+	options.simdLevel = level;
+	options.scaleDenominator = scale;
+	options.pixelFormat = PIXEL_YUV_RAW;
+	struct jpegDecoder* decoder = jpegCreate(&options);
+	if (!decoder) {
+		return NULL;
+	}
+	struct jpegInfo info;
+	unsigned char* planes = NULL;
+	enum jpegStatus status = jpegOpenFile(decoder, path);
+	if (status == JPEG_OK) {
+		status = jpegReadHeader(decoder, &info);
+	}
+	if (status == JPEG_OK) {
+		size_t size = 0;
+		layout->components = info.components;
+		layout->stride = (size_t)info.width;
+		for (int c = 0; c < info.components; c++) {
+			jpegGetPlaneSize(decoder, c, &layout->widths[c], &layout->heights[c]);
+			size += layout->stride * layout->heights[c];
+		}
+		planes = malloc(size);
+		status = planes ? jpegDecode(decoder, planes, layout->stride) : JPEG_ERROR_MEMORY;
+	}
+	jpegDestroy(decoder);
+	if (status != JPEG_OK) {
+		free(planes);
+		return NULL;
+	}
+	return planes;
+}
+
+bool sameLayout(const struct planeLayout* a, const struct planeLayout* b) {
+	if (a->components != b->components || a->stride != b->stride) {
+		return false;
+	}
+	for (int c = 0; c < a->components; c++) {
+		if (a->widths[c] != b->widths[c] || a->heights[c] != b->heights[c]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void comparePlanes(const unsigned char* reference, const unsigned char* samples, const struct planeLayout* layout, struct errorStats* stats) {
+	memset(stats, 0, sizeof(*stats));
+	size_t offset = 0;
+	for (int c = 0; c < layout->components; c++) {
+		for (int y = 0; y < layout->heights[c]; y++) {
+			for (int x = 0; x < layout->widths[c]; x++) {
+				size_t i = offset + y * layout->stride + x;
+				int error = abs(reference[i] - samples[i]);
+				stats->squaredError += (double)error * error;
+				stats->maxError = error > stats->maxError ? error : stats->maxError;
+			}
+		}
+		stats->samples += (double)layout->widths[c] * layout->heights[c];
+		offset += layout->stride * layout->heights[c];
+	}
+}
+
+double psnr(const struct errorStats* stats) {
+	if (stats->squaredError == 0) {
+		return INFINITY;
+	}
+	return 10.0 * log10(255.0 * 255.0 * stats->samples / stats->squaredError);
+}
+
+int checkImage(const char* path) {
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	struct planeLayout layout;
+	unsigned char* reference = decodePlanes(path, IDCT_REFERENCE, SIMD_NONE, 1, &layout);
+	if (!reference) {
+		printf("%-16s could not decode reference\n", name);
+		return 1;
+	}
+	int failures = 0;
+	for (int i = 0; i < (int)(sizeof(idctCases) / sizeof(idctCases[0])); i++) {
+		for (int level = SIMD_NONE; level <= SIMD_AVX2; level++) {
+			const struct idctCase* test = &idctCases[i];
+			struct planeLayout decodedLayout;
+			unsigned char* decoded = decodePlanes(path, test->method, (enum simdLevel)level, 1, &decodedLayout);
+			if (!decoded || !sameLayout(&layout, &decodedLayout)) {
+				printf("%-16s %-6s %-5s could not decode\n", name, test->name, simdNames[level]);
+				free(decoded);
+				failures++;
+				continue;
+			}
+			struct errorStats stats;
+			comparePlanes(reference, decoded, &layout, &stats);
+			free(decoded);
+			bool passed = psnr(&stats) >= test->minPsnr && stats.maxError <= test->maxError;
+			printf("%-16s %-6s %-5s psnr %6.2f dB max error %d %s\n", name, test->name, simdNames[level], psnr(&stats), stats.maxError, passed ? "ok" : "FAILED");
+			failures += passed ? 0 : 1;
+		}
+	}
+	free(reference);
+	for (int i = 0; i < (int)(sizeof(scales) / sizeof(scales[0])); i++) {
+		struct planeLayout decodedLayout;
+		reference = decodePlanes(path, IDCT_REFERENCE, SIMD_NONE, scales[i], &layout);
+		unsigned char* decoded = decodePlanes(path, IDCT_INTEGER, SIMD_NONE, scales[i], &decodedLayout);
+		if (!reference || !decoded || !sameLayout(&layout, &decodedLayout)) {
+			printf("%-16s scaled 1/%-3d could not decode\n", name, scales[i]);
+			free(reference);
+			free(decoded);
+			failures++;
+			continue;
+		}
+		struct errorStats stats;
+		comparePlanes(reference, decoded, &layout, &stats);
+		free(reference);
+		free(decoded);
+		bool passed = psnr(&stats) >= 55.0 && stats.maxError <= 2;
+		printf("%-16s scaled 1/%-3d psnr %6.2f dB max error %d %s\n", name, scales[i], psnr(&stats), stats.maxError, passed ? "ok" : "FAILED");
+		failures += passed ? 0 : 1;
+	}
+	return failures;
+}
+
+void compareBlocks(short reference[8][8], short samples[8][8], int size, struct errorStats* stats) {
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			int error = abs(reference[y][x] - samples[y][x]);
+			stats->squaredError += (double)error * error;
+			stats->maxError = error > stats->maxError ? error : stats->maxError;
+		}
+	}
+	stats->samples += size * size;
+}
+
+void randomBlock(unsigned int* seed, int extent, short coefficients[64]) {
+	memset(coefficients, 0, sizeof(short) * 64);
+	for (int k = 0; k <= extent; k++) {
+		*seed = *seed * 1103515245u + 12345u;
+		int n = naturalOrder[k];
+		int range = 1024 / luminanceQuant[n] / (1 + k / 4);
+		coefficients[n] = (short)((int)(*seed >> 16 & 0x7FFF) % (2 * range + 1) - range);
+	}
+}
+
+int checkSparseKernels(void) {
+	const int blocks = 20000;
+	int failures = 0;
+	struct kernels kernels;
+	float floatQuant[64];
+	for (int level = SIMD_NONE; level <= SIMD_AVX2; level++) {
+		initKernels(&kernels, (enum simdLevel)level);
+		if (kernels.level != (enum simdLevel)level) {
+			printf("kernels          %-5s not supported, skipped\n", simdNames[level]);
+			continue;
+		}
+		for (int n = 0; n < 64; n++) {
+			floatQuant[n] = luminanceQuant[n] * aanScale[n];
+		}
+		const struct sparseCase cases[] = {
+			{ "dc", 0, idctIntegerDc, idctFloatDc },
+			{ "2x2", IDCT_EXTENT_2X2, kernels.idctInteger2x2, kernels.idctFloat2x2 },
+			{ "4x4", IDCT_EXTENT_4X4, kernels.idctInteger4x4, kernels.idctFloat4x4 },
+			{ "full", 63, kernels.idctInteger, kernels.idctFloat }
+		};
+		for (int i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++) {
+			struct errorStats integerStats;
+			struct errorStats floatStats;
+			memset(&integerStats, 0, sizeof(integerStats));
+			memset(&floatStats, 0, sizeof(floatStats));
+			unsigned int seed = 1;
+			for (int b = 0; b < blocks; b++) {
+				_Alignas(32) short coefficients[64];
+				short reference[8][8];
+				short samples[8][8];
+				randomBlock(&seed, cases[i].extent, coefficients);
+				idctReference(coefficients, luminanceQuant, 8, reference);
+				cases[i].idctInteger(coefficients, luminanceQuant, samples);
+				compareBlocks(reference, samples, 8, &integerStats);
+				cases[i].idctFloat(coefficients, floatQuant, samples);
+				compareBlocks(reference, samples, 8, &floatStats);
+			}
+			bool integerPassed = psnr(&integerStats) >= 55.0 && integerStats.maxError <= 1;
+			bool floatPassed = psnr(&floatStats) >= 55.0 && floatStats.maxError <= 1;
+			printf("kernels          int    %-5s %-4s psnr %6.2f dB max error %d %s\n", simdNames[level], cases[i].name, psnr(&integerStats), integerStats.maxError, integerPassed ? "ok" : "FAILED");
+			printf("kernels          float  %-5s %-4s psnr %6.2f dB max error %d %s\n", simdNames[level], cases[i].name, psnr(&floatStats), floatStats.maxError, floatPassed ? "ok" : "FAILED");
+			failures += (integerPassed ? 0 : 1) + (floatPassed ? 0 : 1);
+		}
+	}
+	return failures;
+}
+
+int checkScaledKernels(void) {
+	const int blocks = 20000;
+	int failures = 0;
+	for (int i = 0; i < (int)(sizeof(scaledCases) / sizeof(scaledCases[0])); i++) {
+		struct errorStats stats;
+		memset(&stats, 0, sizeof(stats));
+		unsigned int seed = 1;
+		for (int b = 0; b < blocks; b++) {
+			short coefficients[64];
+			short reference[8][8];
+			short samples[8][8];
+			randomBlock(&seed, 63, coefficients);
+			idctReference(coefficients, luminanceQuant, scaledCases[i].size, reference);
+			scaledCases[i].idct(coefficients, luminanceQuant, samples);
+			compareBlocks(reference, samples, scaledCases[i].size, &stats);
+		}
+		bool passed = psnr(&stats) >= 55.0 && stats.maxError <= 1;
+		printf("kernels          scaled       %-4s psnr %6.2f dB max error %d %s\n", scaledCases[i].name, psnr(&stats), stats.maxError, passed ? "ok" : "FAILED");
+		failures += passed ? 0 : 1;
+	}
+	return failures;
+}
+
+int formatBytes(enum pixelFormat format) {
+	return format == PIXEL_RGB24 ? 3 : format == PIXEL_RGBA32 || format == PIXEL_BGRA32 ? 4 : 1;
+}
+
+int formatPlanes(enum pixelFormat format) {
+	return format == PIXEL_YUV_PLANAR ? 3 : 1;
+}
+
+unsigned char* decodePixels(const char* path, enum pixelFormat format, const int* crop, bool scanlines, int threads, int* width, int* height) {
+	struct jpegOptions options;
+	jpegDefaultOptions(&options);
+	options.pixelFormat = format;
+	options.threads = threads;
+	struct jpegDecoder* decoder = jpegCreate(&options);
+	if (!decoder) {
+		return NULL;
+	}
+	struct jpegInfo info;
+	unsigned char* pixels = NULL;
+	enum jpegStatus status = jpegOpenFile(decoder, path);
+	if (status == JPEG_OK) {
+		status = jpegReadHeader(decoder, &info);
+	}
+	if (status == JPEG_OK && crop) {
+		status = jpegSetCrop(decoder, crop[0], crop[1], crop[2], crop[3]);
+	}
+	if (status == JPEG_OK) {
+		*width = crop ? crop[2] : info.width;
+		*height = crop ? crop[3] : info.height;
+		size_t stride = (size_t)*width * formatBytes(format);
+		pixels = malloc(stride * *height * formatPlanes(format));
+		if (!pixels) {
+			status = JPEG_ERROR_MEMORY;
+		} else if (scanlines) {
+			int row = 0;
+			while (status == JPEG_OK && row < *height) {
+				int rowsRead = 0;
+				status = jpegReadScanlines(decoder, pixels + row * stride, stride, *height - row < 7 ? *height - row : 7, &rowsRead);
+				status = status == JPEG_OK && rowsRead == 0 ? JPEG_ERROR_FORMAT : status;
+				row += rowsRead;
+			}
+		} else {
+			status = jpegDecode(decoder, pixels, stride);
+		}
+	}
+	jpegDestroy(decoder);
+	if (status != JPEG_OK) {
+		free(pixels);
+		return NULL;
+	}
+	return pixels;
+}
+
+unsigned char* expectedPixels(enum pixelFormat format, const unsigned char* rgb, const unsigned char* yuv, int width, int height) {
+	size_t count = (size_t)width * height;
+	unsigned char* pixels = malloc(count * formatBytes(format) * formatPlanes(format));
+	if (!pixels) {
+		return NULL;
+	}
+	if (format == PIXEL_RGB24) {
+		memcpy(pixels, rgb, count * 3);
+	} else if (format == PIXEL_GRAY8) {
+		memcpy(pixels, yuv, count);
+	} else if (format == PIXEL_YUV_PLANAR) {
+		memcpy(pixels, yuv, count * 3);
+	} else {
+		bool bgra = format == PIXEL_BGRA32;
+		for (size_t i = 0; i < count; i++) {
+			pixels[i * 4] = rgb[i * 3 + (bgra ? 2 : 0)];
+			pixels[i * 4 + 1] = rgb[i * 3 + 1];
+			pixels[i * 4 + 2] = rgb[i * 3 + (bgra ? 0 : 2)];
+			pixels[i * 4 + 3] = 255;
+		}
+	}
+	return pixels;
+}
+
+int convertedMismatches(const unsigned char* rgb, const unsigned char* yuv, int width, int height) {
+	struct kernels scalar;
+	initKernels(&scalar, SIMD_NONE);
+	size_t planeSize = (size_t)width * height;
+	short* samples = malloc(sizeof(short) * 3 * width);
+	unsigned char* converted = malloc((size_t)width * 3);
+	if (!samples || !converted) {
+		free(samples);
+		free(converted);
+		return width * height * 3;
+	}
+	int mismatches = 0;
+	for (int y = 0; y < height; y++) {
+		for (int i = 0; i < width * 3; i++) {
+			samples[i] = yuv[i / width * planeSize + (size_t)y * width + i % width];
+		}
+		scalar.colorConvert(samples, samples + width, samples + width * 2, converted, width, PIXEL_RGB24);
+		for (int i = 0; i < width * 3; i++) {
+			mismatches += converted[i] != rgb[(size_t)y * width * 3 + i];
+		}
+	}
+	free(samples);
+	free(converted);
+	return mismatches;
+}
+
+int regionMismatches(const unsigned char* expected, int width, int height, const unsigned char* pixels, const int* region, enum pixelFormat format) {
+	int bytes = formatBytes(format);
+	int mismatches = 0;
+	for (int plane = 0; plane < formatPlanes(format); plane++) {
+		for (int y = 0; y < region[3]; y++) {
+			const unsigned char* reference = expected + ((size_t)plane * height + region[1] + y) * width * bytes + (size_t)region[0] * bytes;
+			const unsigned char* row = pixels + ((size_t)plane * region[3] + y) * region[2] * bytes;
+			for (int i = 0; i < region[2] * bytes; i++) {
+				mismatches += reference[i] != row[i];
+			}
+		}
+	}
+	return mismatches;
+}
+
+void cropRegion(int width, int height, int crop[4]) {
+	crop[0] = width / 3;
+	crop[1] = height / 5;
+	crop[2] = width - width / 3 - width / 4;
+	crop[3] = height - height / 5 - height / 6;
+}
+
+int checkFormats(const char* path) {
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	int width = 0, height = 0, yuvWidth = 0, yuvHeight = 0;
+	unsigned char* rgb = decodePixels(path, PIXEL_RGB24, NULL, false, 1, &width, &height);
+	unsigned char* yuv = decodePixels(path, PIXEL_YUV_PLANAR, NULL, false, 1, &yuvWidth, &yuvHeight);
+	if (!rgb || !yuv || width != yuvWidth || height != yuvHeight) {
+		printf("%-16s could not decode formats\n", name);
+		free(rgb);
+		free(yuv);
+		return 1;
+	}
+	int failures = 0;
+	int mismatches = convertedMismatches(rgb, yuv, width, height);
+	printf("%-16s format yuv  converted to rgb %d samples differ %s\n", name, mismatches, mismatches ? "FAILED" : "ok");
+	failures += mismatches ? 1 : 0;
+	const int full[4] = { 0, 0, width, height };
+	int crop[4];
+	cropRegion(width, height, crop);
+	for (int i = 0; i < (int)(sizeof(formatCases) / sizeof(formatCases[0])); i++) {
+		enum pixelFormat format = formatCases[i].format;
+		unsigned char* expected = expectedPixels(format, rgb, yuv, width, height);
+		if (!expected) {
+			printf("%-16s format %-4s out of memory\n", name, formatCases[i].name);
+			failures++;
+			continue;
+		}
+		for (int variant = 0; variant < 4; variant++) {
+			bool cropped = variant & 1;
+			bool scanlines = variant & 2;
+			if (scanlines && format == PIXEL_YUV_PLANAR) {
+				continue;
+			}
+			const int* region = cropped ? crop : full;
+			int decodedWidth = 0, decodedHeight = 0;
+			unsigned char* pixels = decodePixels(path, format, cropped ? crop : NULL, scanlines, 1, &decodedWidth, &decodedHeight);
+			if (!pixels || decodedWidth != region[2] || decodedHeight != region[3]) {
+				printf("%-16s format %-4s %-4s %-9s could not decode FAILED\n", name, formatCases[i].name, cropped ? "crop" : "full", scanlines ? "scanlines" : "decode");
+				free(pixels);
+				failures++;
+				continue;
+			}
+			mismatches = regionMismatches(expected, width, height, pixels, region, format);
+			free(pixels);
+			printf("%-16s format %-4s %-4s %-9s %d samples differ %s\n", name, formatCases[i].name, cropped ? "crop" : "full", scanlines ? "scanlines" : "decode", mismatches, mismatches ? "FAILED" : "ok");
+			failures += mismatches ? 1 : 0;
+		}
+		free(expected);
+	}
+	free(rgb);
+	free(yuv);
+	return failures;
+}
+
+int checkThreads(const char* path) {
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	int width = 0, height = 0, cropWidth = 0, cropHeight = 0;
+	int crop[4];
+	unsigned char* references[2] = { decodePixels(path, PIXEL_RGB24, NULL, false, 1, &width, &height), NULL };
+	if (references[0]) {
+		cropRegion(width, height, crop);
+		references[1] = decodePixels(path, PIXEL_RGB24, crop, false, 1, &cropWidth, &cropHeight);
+	}
+	if (!references[0] || !references[1]) {
+		printf("%-16s threads could not decode reference\n", name);
+		free(references[0]);
+		free(references[1]);
+		return 1;
+	}
+	int failures = 0;
+	for (int cropped = 0; cropped < 2; cropped++) {
+		for (int threads = 2; threads <= 4; threads++) {
+			int decodedWidth = 0, decodedHeight = 0;
+			unsigned char* pixels = decodePixels(path, PIXEL_RGB24, cropped ? crop : NULL, false, threads, &decodedWidth, &decodedHeight);
+			size_t size = cropped ? (size_t)crop[2] * crop[3] * 3 : (size_t)width * height * 3;
+			bool passed = pixels && memcmp(references[cropped], pixels, size) == 0;
+			printf("%-16s threads %d %-4s %s\n", name, threads, cropped ? "crop" : "full", passed ? "identical to 1 thread ok" : "differs from 1 thread FAILED");
+			failures += passed ? 0 : 1;
+			free(pixels);
+		}
+	}
+	free(references[0]);
+	free(references[1]);
+	return failures;
+}
+
+void batchDecoded(void* user, int worker, int index, struct jpegDecoder* decoder, enum jpegStatus status, const unsigned char* pixels, size_t stride) {
+	struct batchCheck* check = (struct batchCheck*)user;
+	int width = check->widths[index];
+	int height = check->heights[index];
+	int mismatches = status == JPEG_OK && check->references[index] ? 0 : -1;
+	for (int y = 0; y < height && mismatches >= 0; y++) {
+		mismatches += memcmp(check->references[index] + (size_t)y * width * 3, pixels + y * stride, (size_t)width * 3) != 0;
+	}
+	check->mismatches[index] = mismatches;
+}
+
+int checkBatch(const char* const* paths, int count) {
+	struct batchCheck check;
+	check.references = calloc(count, sizeof(unsigned char*));
+	check.widths = calloc(count, sizeof(int));
+	check.heights = calloc(count, sizeof(int));
+	check.mismatches = malloc(sizeof(int) * count);
+	if (!check.references || !check.widths || !check.heights || !check.mismatches) {
+		free(check.references);
+		free(check.widths);
+		free(check.heights);
+		free(check.mismatches);
+		printf("batch            out of memory\n");
+		return 1;
+	}
+	for (int i = 0; i < count; i++) {
+		check.references[i] = decodePixels(paths[i], PIXEL_RGB24, NULL, false, 1, &check.widths[i], &check.heights[i]);
+		check.mismatches[i] = -2;
+	}
+	struct jpegOptions options;
+	jpegDefaultOptions(&options);
+	options.threads = 3;
+	struct jpegBatchStats stats;
+	enum jpegStatus status = jpegDecodeFiles(&options, paths, count, batchDecoded, &check, &stats);
+	int failures = 0;
+	for (int i = 0; i < count; i++) {
+		const char* name = strrchr(paths[i], '/');
+		name = name ? name + 1 : paths[i];
+		bool passed = check.mismatches[i] == 0;
+		printf("%-16s batch   %s\n", name, passed ? "identical to single decode ok" : check.mismatches[i] == -2 ? "not decoded FAILED" : "differs from single decode FAILED");
+		failures += passed ? 0 : 1;
+		free(check.references[i]);
+	}
+	bool passed = status == JPEG_OK && stats.images == count && stats.failures == 0;
+	printf("batch            %d images %d failures: %s %s\n", stats.images, stats.failures, jpegStatusString(status), passed ? "ok" : "FAILED");
+	failures += passed ? 0 : 1;
+	free(check.references);
+	free(check.widths);
+	free(check.heights);
+	free(check.mismatches);
+	return failures;
+}
+
+void extremeBlock(unsigned int* seed, int extent, short coefficients[64], int quant[64]) {
+	memset(coefficients, 0, sizeof(short) * 64);
+	for (int k = 0; k < 64; k++) {
+		*seed = *seed * 1103515245u + 12345u;
+		quant[k] = (int)(*seed >> 16 & 0xFFFF) | 0x8000;
+		if (k <= extent) {
+			coefficients[naturalOrder[k]] = (short)(*seed & 0x100 ? 32767 : -32768);
+		}
+	}
+}
+
+int checkExtremeCoefficients(void) {
+	const int blocks = 1000;
+	int failures = 0;
+	struct kernels scalar;
+	struct kernels kernels;
+	initKernels(&scalar, SIMD_NONE);
+	unsigned int seed = 1;
+	int mismatches = 0;
+	for (int b = 0; b < blocks; b++) {
+		short coefficients[64];
+		int quant[64];
+		short samples[8][8];
+		extremeBlock(&seed, 63, coefficients, quant);
+		int dc = coefficients[0] * quant[0];
+		dc = dc < -32768 ? -32768 : dc > 32767 ? 32767 : dc;
+		int expected = ((dc + 4) >> 3) + 128;
+		expected = expected < 0 ? 0 : expected > 255 ? 255 : expected;
+		idctIntegerDc(coefficients, quant, samples);
+		mismatches += samples[7][7] != expected;
+		idctScaled1x1(coefficients, quant, samples);
+		mismatches += samples[0][0] != expected;
+		idctScaled2x2(coefficients, quant, samples);
+		idctScaled4x4(coefficients, quant, samples);
+	}
+	printf("kernels          extreme dc         %d of %d blocks differ from clamped dc %s\n", mismatches, blocks, mismatches ? "FAILED" : "ok");
+	failures += mismatches ? 1 : 0;
+	for (int level = SIMD_SSE2; level <= SIMD_AVX2; level++) {
+		initKernels(&kernels, (enum simdLevel)level);
+		if (kernels.level != (enum simdLevel)level) {
+			continue;
+		}
+		const struct sparseCase cases[] = {
+			{ "2x2", IDCT_EXTENT_2X2, kernels.idctInteger2x2, NULL },
+			{ "4x4", IDCT_EXTENT_4X4, kernels.idctInteger4x4, NULL },
+			{ "full", 63, kernels.idctInteger, NULL }
+		};
+		void (*scalarIdcts[])(const short* coefficients, const int* quant, short output[8][8]) = { scalar.idctInteger2x2, scalar.idctInteger4x4, scalar.idctInteger };
+		for (int i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++) {
+			mismatches = 0;
+			seed = 1;
+			for (int b = 0; b < blocks; b++) {
+				_Alignas(32) short coefficients[64];
+				int quant[64];
+				short reference[8][8];
+				short samples[8][8];
+				extremeBlock(&seed, cases[i].extent, coefficients, quant);
+				scalarIdcts[i](coefficients, quant, reference);
+				cases[i].idctInteger(coefficients, quant, samples);
+				mismatches += memcmp(reference, samples, sizeof(reference)) != 0;
+			}
+			printf("kernels          extreme %-5s %-4s %d of %d blocks differ from scalar %s\n", simdNames[level], cases[i].name, mismatches, blocks, mismatches ? "FAILED" : "ok");
+			failures += mismatches ? 1 : 0;
+		}
+	}
+	return failures;
+}
+
+unsigned char* readFile(const char* fileName, size_t* size) {
+	FILE* file = NULL;
+#ifdef _MSC_VER
+	if (fopen_s(&file, fileName, "rb") != 0) {
+		return NULL;
+	}
+#else
+	file = fopen(fileName, "rb");
+	if (!file) {
+		return NULL;
+	}
+#endif
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	unsigned char* data = length > 0 ? malloc(length) : NULL;
+	if (!data || fread(data, 1, length, file) != (size_t)length) {
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+	*size = (size_t)length;
+	return data;
+}
+
+enum jpegStatus decodeMemory(const unsigned char* data, size_t size) {
+	struct jpegOptions options;
+	jpegDefaultOptions(&options);
+	struct jpegDecoder* decoder = jpegCreate(&options);
+	if (!decoder) {
+		return JPEG_ERROR_MEMORY;
+	}
+	struct jpegInfo info;
+	unsigned char* pixels = NULL;
+	enum jpegStatus status = jpegOpenMemory(decoder, data, size);
+	if (status == JPEG_OK) {
+		status = jpegReadHeader(decoder, &info);
+	}
+	if (status == JPEG_OK) {
+		pixels = malloc((size_t)info.width * info.height * 3);
+		status = pixels ? jpegDecode(decoder, pixels, (size_t)info.width * 3) : JPEG_ERROR_MEMORY;
+	}
+	free(pixels);
+	jpegDestroy(decoder);
+	return status;
+}
+
+size_t findSegment(const unsigned char* data, size_t size, unsigned char marker) {
+	size_t pos = 2;
+	while (pos + 1 < size && !(data[pos] == 0xFF && data[pos + 1] == marker)) {
+		pos++;
+	}
+	return pos;
+}
+
+int checkCorruptSegments(const char* path) {
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	size_t size = 0;
+	unsigned char* data = readFile(path, &size);
+	if (!data) {
+		printf("%-16s could not read file\n", name);
+		return 1;
+	}
+	size_t table = findSegment(data, size, 0xC4);
+	if (table + 21 >= size) {
+		printf("%-16s no huffman table\n", name);
+		free(data);
+		return 1;
+	}
+	int failures = 0;
+	const int corruptions[][2] = { { 0, 3 }, { 1, 5 }, { 8, 255 } };
+	for (int i = 0; i < (int)(sizeof(corruptions) / sizeof(corruptions[0])); i++) {
+		unsigned char* lengths = data + table + 5;
+		unsigned char saved = lengths[corruptions[i][0]];
+		lengths[corruptions[i][0]] = (unsigned char)corruptions[i][1];
+		enum jpegStatus status = decodeMemory(data, size);
+		lengths[corruptions[i][0]] = saved;
+		bool passed = status == JPEG_ERROR_FORMAT;
+		printf("%-16s dht          %d codes of length %d: %s %s\n", name, corruptions[i][1], corruptions[i][0] + 1, jpegStatusString(status), passed ? "ok" : "FAILED");
+		failures += passed ? 0 : 1;
+	}
+	size_t scan = findSegment(data, size, 0xDA);
+	size_t approximation = scan + 4 < size ? scan + 7 + data[scan + 4] * 2 : size;
+	if (approximation < size) {
+		unsigned char saved = data[approximation];
+		data[approximation] = 0x0F;
+		enum jpegStatus status = decodeMemory(data, size);
+		data[approximation] = saved;
+		bool passed = status == JPEG_ERROR_FORMAT;
+		printf("%-16s sos          successive approximation 0/15: %s %s\n", name, jpegStatusString(status), passed ? "ok" : "FAILED");
+		failures += passed ? 0 : 1;
+	}
+	unsigned char* truncated = scan + 4 <= size ? malloc(scan + 4) : NULL;
+	if (truncated) {
+		memcpy(truncated, data, scan + 2);
+		truncated[scan + 2] = 0;
+		truncated[scan + 3] = 2;
+		enum jpegStatus status = decodeMemory(truncated, scan + 4);
+		free(truncated);
+		bool passed = status == JPEG_ERROR_FORMAT;
+		printf("%-16s sos          length 2 at end of data: %s %s\n", name, jpegStatusString(status), passed ? "ok" : "FAILED");
+		failures += passed ? 0 : 1;
+	}
+	free(data);
+	return failures;
+}
+
+int main(int argc, char* argv[]) {
+	const char* directory = "../Jpeg Decoder";
+	int arg = 1;
+	while (arg + 1 < argc && argv[arg][0] == '-') {
+		if (strcmp(argv[arg], "-dir") == 0) {
+			directory = argv[arg + 1];
+		} else {
+			printf("unknown option %s\n", argv[arg]);
+			return 1;
+		}
+		arg += 2;
+	}
+	int numImages = arg < argc ? argc - arg : (int)(sizeof(defaultImages) / sizeof(defaultImages[0]));
+	int failures = checkSparseKernels() + checkScaledKernels() + checkExtremeCoefficients();
+	char (*paths)[1024] = malloc(sizeof(*paths) * numImages);
+	const char** pathList = malloc(sizeof(const char*) * numImages);
+	if (!paths || !pathList) {
+		free(paths);
+		free(pathList);
+		printf("out of memory\n");
+		return 1;
+	}
+	for (int i = 0; i < numImages; i++) {
+		if (arg < argc) {
+			snprintf(paths[i], sizeof(paths[i]), "%s", argv[arg + i]);
+		} else {
+			snprintf(paths[i], sizeof(paths[i]), "%s/%s", directory, defaultImages[i]);
+		}
+		pathList[i] = paths[i];
+		failures += checkImage(paths[i]) + checkFormats(paths[i]) + checkThreads(paths[i]);
+		if (i == 0) {
+			failures += checkCorruptSegments(paths[i]);
+		}
+	}
+	failures += checkBatch(pathList, numImages);
+	free(paths);
+	free(pathList);
+	printf("%s: %d failure%s\n", failures ? "FAILED" : "passed", failures, failures == 1 ? "" : "s");
+	return failures ? 1 : 0;
+}